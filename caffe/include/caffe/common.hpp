@@ -171,6 +171,11 @@ class Caffe {
   inline static void set_multiprocess(bool val) { Get().multiprocess_ = val; }
   inline static bool root_solver() { return Get().solver_rank_ == 0; }
   inline static void device_synchronize() { CUDA_CHECK(cudaDeviceSynchronize()); }
+  // Number of OpenMP threads CPU layers may use on behalf of the calling
+  // thread.  Defaults to 1 so that callers that already run a net per core
+  // don't oversubscribe it.
+  inline static int cpu_threads() { return Get().cpu_threads_; }
+  inline static void set_cpu_threads(int val) { Get().cpu_threads_ = val; }
 
  protected:
 #ifndef CPU_ONLY
@@ -186,6 +191,7 @@ class Caffe {
   int solver_count_;
   int solver_rank_;
   bool multiprocess_;
+  int cpu_threads_;
 
  private:
   // The private constructor to avoid duplicate instantiation.
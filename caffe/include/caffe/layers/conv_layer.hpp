@@ -60,9 +60,22 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
    *  - bias_term (\b optional, default true). Whether to have a bias.
    *  - engine: convolution has CAFFE (matrix multiplication) and CUDNN (library
    *    kernels + stream parallelism) engines.
+   *  - fuse_relu (\b optional, default false). Apply a ReLU to the output, as
+   *    if followed by an in-place ReLU layer.
+   *  - sparse_input (\b optional, default false). The input is mostly zero,
+   *    so the direct CPU convolution skips empty input rows.
+   *  - precision (\b optional, default FP32). With INT8 the direct CPU
+   *    convolution uses quantized weights and inputs in the TEST phase.
+   *
+   *  On the CPU in the TEST phase, stride 1 3D convolutions with small cubic
+   *  kernels are computed directly (see direct_conv.hpp) instead of through
+   *  im2col.
    */
   explicit ConvolutionLayer(const LayerParameter& param)
-      : BaseConvolutionLayer<Dtype>(param) {}
+      : BaseConvolutionLayer<Dtype>(param),
+        fuse_relu_(param.convolution_param().fuse_relu()),
+        sparse_input_(param.convolution_param().sparse_input()),
+        packed_version_(0), int8_version_(0) {}
 
   virtual inline const char* type() const { return "Convolution"; }
 
@@ -82,6 +95,36 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return false; }
   virtual void compute_output_shape();
+
+  // true if Forward_cpu can use the direct 3D convolution
+  bool use_direct_cpu();
+  void forward_cpu_direct(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  void forward_cpu_int8(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  // true if the weights were modified since the last call with this
+  // (memory, version) pair, which is then updated
+  bool weights_changed(shared_ptr<SyncedMemory>* from, unsigned long* version);
+  // zero the diff of top wherever the fused relu clamped the output
+  void fused_relu_backward_cpu(Blob<Dtype>* top);
+#ifndef CPU_ONLY
+  void fused_relu_forward_gpu(Blob<Dtype>* top);
+  void fused_relu_backward_gpu(Blob<Dtype>* top);
+#endif
+
+  bool fuse_relu_;
+  bool sparse_input_;
+  Blob<Dtype> packed_weight_;
+  Blob<int> row_extents_;
+  // quantized weights, input and per output channel scales for INT8
+  vector<int16_t> int8_weight_;
+  vector<int16_t> int8_input_;
+  vector<float> int8_weight_scale_;
+  vector<float> int8_out_scale_;
+  // weight memory and version packed_weight_ and int8_weight_ were made
+  // from, so they are only redone after the weights change
+  shared_ptr<SyncedMemory> packed_from_, int8_from_;
+  unsigned long packed_version_, int8_version_;
 };
 
 }  // namespace caffe
@@ -14,19 +14,25 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "gninasrc/lib/gridpack.h"
 
 namespace caffe {
 
 /**
  * @brief Provides data to the Net from n-dimension  files of raw floating point data.
  *
+ * Examples are either listed in source as a label followed by the files
+ * that make up the example, or, if packed is set, source is a single
+ * memory mapped gridpack file (see gninagrid --types).  Examples of a batch
+ * are loaded, decompressed and rotated by prefetch_threads workers.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
 class NDimDataLayer : public BasePrefetchingDataLayer<Dtype> {
  public:
   explicit NDimDataLayer(const LayerParameter& param)
-      : BasePrefetchingDataLayer<Dtype>(param), actives_pos_(0),
+      : BasePrefetchingDataLayer<Dtype>(param), num_workers(1), actives_pos_(0),
         decoys_pos_(0), all_pos_(0), example_size(0), num_rotations(0), current_rotation(0),data_avail(0) {}
   virtual ~NDimDataLayer();
   virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
@@ -46,13 +52,25 @@ class NDimDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual void Shuffle();
   virtual void load_batch(Batch<Dtype>* batch);
 
-  virtual void load_data_from_files(Dtype*, const std::string& root, const vector<std::string>& files);
+  //an example is either a list of files or an index into the packed file
+  struct example_ref {
+    vector<std::string> files;
+    size_t packed_index;
+    example_ref(): packed_index(0) {}
+  };
+
+  virtual void load_data_from_files(Dtype*, const std::string& root, const vector<std::string>& files, unsigned rot);
+  virtual void load_data_from_pack(Dtype*, size_t index, unsigned rot);
+  void load_example(Dtype*, const std::string& root, const example_ref& ex, unsigned rot);
+  void load_examples(Dtype* data, const std::string& root, const vector<example_ref>& exs, const vector<unsigned>& rots, unsigned start);
   const vector<int> blob2vec(const BlobShape& b) const;
 
   virtual void rotate_data(Dtype *data, unsigned rot);
-  vector<vector<std::string> > actives_;
-  vector<vector<std::string> > decoys_;
-  vector<std::pair< vector<std::string>, float> > all_;
+  vector<example_ref> actives_;
+  vector<example_ref> decoys_;
+  vector<std::pair< example_ref, float> > all_;
+  gridpack_reader pack_; //if packed, all data comes from here
+  unsigned num_workers;
   int actives_pos_, decoys_pos_, all_pos_;
   unsigned example_size;
   unsigned num_rotations;
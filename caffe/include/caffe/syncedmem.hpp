@@ -69,6 +69,10 @@ class SyncedMemory {
   SyncedHead head() { return head_; }
   size_t size() { return size_; }
   void clear();
+  // Incremented whenever the data may have been modified, i.e. on every
+  // mutable_*_data, set_*_data and clear, so that derived copies such as
+  // repacked weights can tell when they are stale.
+  unsigned long version() const { return version_; }
 
 #ifndef CPU_ONLY
   void async_gpu_push(const cudaStream_t& stream);
@@ -87,6 +91,7 @@ class SyncedMemory {
   bool cpu_malloc_use_cuda_;
   bool own_gpu_data_;
   int device_;
+  unsigned long version_;
 
   DISABLE_COPY_AND_ASSIGN(SyncedMemory);
 };  // class SyncedMemory
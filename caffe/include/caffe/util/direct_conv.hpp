@@ -0,0 +1,96 @@
+#ifndef _CAFFE_UTIL_DIRECT_CONV_HPP_
+#define _CAFFE_UTIL_DIRECT_CONV_HPP_
+
+#include <stdint.h>
+#include <cstddef>
+
+namespace caffe {
+
+// Number of output channels computed together by direct_conv3d_cpu.  Weights
+// are repacked so that these are contiguous and stay in registers.
+const int kDirectConvOutputBlock = 8;
+
+// Size of the buffer needed by direct_conv3d_pack_weights.
+inline int direct_conv3d_packed_size(const int num_output, const int channels,
+    const int kernel) {
+  const int blocks = (num_output + kDirectConvOutputBlock - 1)
+      / kDirectConvOutputBlock;
+  return blocks * kDirectConvOutputBlock * channels * kernel * kernel * kernel;
+}
+
+// Reorder num_output x channels x k x k x k weights into output channel
+// blocks (blocks x channels x k x k x k x kDirectConvOutputBlock), padding
+// the last block with zeros.
+template <typename Dtype>
+void direct_conv3d_pack_weights(const Dtype* weight, const int num_output,
+    const int channels, const int kernel, Dtype* packed);
+
+// For every row (channel, z, y) of a channels x depth x height x width input
+// store the half open range [lo, hi) of columns that are non-zero in
+// extents[2*row], extents[2*row+1].  Empty rows get lo == hi == 0.
+template <typename Dtype>
+void direct_conv3d_row_extents(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width, int* extents);
+
+// Stride 1, undilated, ungrouped 3D convolution of a single
+// channels x depth x height x width input with a cubic kernel, computed
+// directly without a column buffer.  Output channels are processed in blocks
+// in parallel on Caffe::cpu_threads() threads (when built with OpenMP).  bias
+// may be NULL.  If relu is set negative outputs are clamped to zero.  If
+// extents (from direct_conv3d_row_extents) is provided, input rows that are
+// zero where an output tile would read them are skipped, which makes sparse
+// inputs such as molecular density grids much cheaper.
+template <typename Dtype>
+void direct_conv3d_cpu(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width,
+    const Dtype* packed_weight, const int num_output, const int kernel,
+    const int pad, const Dtype* bias, const bool relu, Dtype* data_out,
+    const int* extents = NULL);
+
+// INT8 inference.  Inputs are quantized symmetrically to [-127, 127] with one
+// scale per example and weights with one scale per output channel.  Values
+// are stored as int16_t, channel last, so that every output is a sum of
+// contiguous dot products that compilers turn into 16 bit multiply-adds
+// (pmaddwd and friends); the int8 range keeps the 32 bit sums from
+// overflowing.
+
+// Number of values in a padded channel last input.
+inline int direct_conv3d_int8_input_size(const int channels, const int depth,
+    const int height, const int width, const int pad) {
+  return (depth + 2 * pad) * (height + 2 * pad) * (width + 2 * pad) * channels;
+}
+
+// Quantize a channels x depth x height x width input into a zero padded
+// depth x height x width x channels array.  Returns the scale.
+template <typename Dtype>
+float direct_conv3d_int8_pack_input(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width, const int pad,
+    int16_t* packed);
+
+// Quantize num_output x channels x k x k x k weights into
+// num_output x k x k x k x channels with a scale per output channel.
+template <typename Dtype>
+void direct_conv3d_int8_pack_weights(const Dtype* weight,
+    const int num_output, const int channels, const int kernel,
+    int16_t* packed, float* scales);
+
+// Same as direct_conv3d_cpu on the packed input and weights.  The sum for
+// output channel oc is multiplied by out_scale[oc] (input scale times weight
+// scale) before the bias is added.
+template <typename Dtype>
+void direct_conv3d_int8_cpu(const int16_t* packed_im, const int channels,
+    const int depth, const int height, const int width,
+    const int16_t* packed_weight, const int num_output, const int kernel,
+    const int pad, const float* out_scale, const Dtype* bias, const bool relu,
+    Dtype* data_out);
+
+// A 1x1x1 unpadded convolution is a single GEMM of the weights with the
+// input, with bias and relu applied on the result.
+template <typename Dtype>
+void direct_conv1x1_cpu(const Dtype* data_im, const int channels,
+    const int spatial_dim, const Dtype* weight, const int num_output,
+    const Dtype* bias, const bool relu, Dtype* data_out);
+
+}  // namespace caffe
+
+#endif  // _CAFFE_UTIL_DIRECT_CONV_HPP_
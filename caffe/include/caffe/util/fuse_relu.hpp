@@ -0,0 +1,15 @@
+#ifndef _CAFFE_UTIL_FUSE_RELU_HPP_
+#define _CAFFE_UTIL_FUSE_RELU_HPP_
+
+#include "caffe/proto/caffe.pb.h"
+
+namespace caffe {
+
+// Remove every in-place ReLU layer that directly follows the Convolution
+// producing its input and set fuse_relu on that convolution instead.  The
+// resulting net computes the same outputs and gradients.
+void FuseConvolutionReLU(NetParameter* param);
+
+}  // namespace caffe
+
+#endif  // _CAFFE_UTIL_FUSE_RELU_HPP_
@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <vector>
 
 #include "caffe/layers/conv_layer.hpp"
+#include "caffe/util/direct_conv.hpp"
 
 namespace caffe {
 
@@ -21,9 +23,153 @@ void ConvolutionLayer<Dtype>::compute_output_shape() {
   }
 }
 
+// Largest cubic kernel computed with direct_conv3d_cpu.  Beyond this the
+// column buffer is amortized well enough by the GEMM.
+static const int kMaxDirectConvKernel = 5;
+
+template <typename Dtype>
+bool ConvolutionLayer<Dtype>::use_direct_cpu() {
+  if (this->num_spatial_axes_ != 3 || this->group_ != 1) {
+    return false;
+  }
+  const int* kernel_shape_data = this->kernel_shape_.cpu_data();
+  const int* stride_data = this->stride_.cpu_data();
+  const int* pad_data = this->pad_.cpu_data();
+  const int* dilation_data = this->dilation_.cpu_data();
+  for (int i = 0; i < 3; ++i) {
+    if (kernel_shape_data[i] != kernel_shape_data[0] ||
+        pad_data[i] != pad_data[0] || stride_data[i] != 1 ||
+        dilation_data[i] != 1) {
+      return false;
+    }
+  }
+  return kernel_shape_data[0] <= kMaxDirectConvKernel &&
+      pad_data[0] < kernel_shape_data[0];
+}
+
+template <typename Dtype>
+bool ConvolutionLayer<Dtype>::weights_changed(shared_ptr<SyncedMemory>* from,
+    unsigned long* version) {
+  const shared_ptr<SyncedMemory>& weights = this->blobs_[0]->data();
+  if (*from == weights && *version == weights->version()) {
+    return false;
+  }
+  *from = weights;
+  *version = weights->version();
+  return true;
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_direct(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  const int kernel = this->kernel_shape_.cpu_data()[0];
+  const int pad = this->pad_.cpu_data()[0];
+  const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  const bool gemm = kernel == 1 && pad == 0;
+  if (!gemm) {
+    if (weights_changed(&packed_from_, &packed_version_)) {
+      packed_weight_.Reshape(vector<int>(1, direct_conv3d_packed_size(
+          this->num_output_, this->channels_, kernel)));
+      direct_conv3d_pack_weights(weight, this->num_output_, this->channels_,
+          kernel, packed_weight_.mutable_cpu_data());
+    }
+    if (sparse_input_) {
+      row_extents_.Reshape(vector<int>(1, 2 * this->bottom_dim_
+          / this->input_shape(3)));
+    }
+  }
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      if (gemm) {
+        direct_conv1x1_cpu(bottom_data + n * this->bottom_dim_,
+            this->channels_, this->out_spatial_dim_, weight, this->num_output_,
+            bias, fuse_relu_, top_data + n * this->top_dim_);
+      } else {
+        const Dtype* input = bottom_data + n * this->bottom_dim_;
+        int* extents = NULL;
+        if (sparse_input_) {
+          extents = row_extents_.mutable_cpu_data();
+          direct_conv3d_row_extents(input, this->channels_,
+              this->input_shape(1), this->input_shape(2), this->input_shape(3),
+              extents);
+        }
+        direct_conv3d_cpu(input, this->channels_,
+            this->input_shape(1), this->input_shape(2), this->input_shape(3),
+            packed_weight_.cpu_data(), this->num_output_, kernel, pad, bias,
+            fuse_relu_, top_data + n * this->top_dim_, extents);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_cpu_int8(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  const int kernel = this->kernel_shape_.cpu_data()[0];
+  const int pad = this->pad_.cpu_data()[0];
+  const int depth = this->input_shape(1);
+  const int height = this->input_shape(2);
+  const int width = this->input_shape(3);
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  if (weights_changed(&int8_from_, &int8_version_)) {
+    int8_weight_.resize(this->blobs_[0]->count());
+    int8_weight_scale_.resize(this->num_output_);
+    direct_conv3d_int8_pack_weights(this->blobs_[0]->cpu_data(),
+        this->num_output_, this->channels_, kernel, &int8_weight_[0],
+        &int8_weight_scale_[0]);
+  }
+  int8_out_scale_.resize(this->num_output_);
+  int8_input_.resize(direct_conv3d_int8_input_size(this->channels_, depth,
+      height, width, pad));
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      const float scale = direct_conv3d_int8_pack_input(
+          bottom_data + n * this->bottom_dim_, this->channels_, depth, height,
+          width, pad, &int8_input_[0]);
+      for (int o = 0; o < this->num_output_; ++o) {
+        int8_out_scale_[o] = int8_weight_scale_[o] * scale;
+      }
+      direct_conv3d_int8_cpu(&int8_input_[0], this->channels_, depth, height,
+          width, &int8_weight_[0], this->num_output_, kernel, pad,
+          &int8_out_scale_[0], bias, fuse_relu_,
+          top_data + n * this->top_dim_);
+    }
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::fused_relu_backward_cpu(Blob<Dtype>* top) {
+  const Dtype* top_data = top->cpu_data();
+  Dtype* top_diff = top->mutable_cpu_diff();
+  for (int i = 0, n = top->count(); i < n; ++i) {
+    if (top_data[i] <= 0) {
+      top_diff[i] = 0;
+    }
+  }
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
+  // the direct kernels are for inference; training keeps the im2col path so
+  // forward and backward share the same GEMM arithmetic
+  if (this->phase_ == TEST && use_direct_cpu()) {
+    const ConvolutionParameter& conv_param =
+        this->layer_param_.convolution_param();
+    // skipping zeros beats quantizing them, so sparse inputs stay FP32
+    if (!sparse_input_ &&
+        conv_param.precision() == ConvolutionParameter_Precision_INT8) {
+      forward_cpu_int8(bottom, top);
+    } else {
+      forward_cpu_direct(bottom, top);
+    }
+    return;
+  }
   const Dtype* weight = this->blobs_[0]->cpu_data();
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
@@ -36,6 +182,11 @@ void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
         this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
       }
     }
+    if (fuse_relu_) {
+      for (int j = 0, n = top[i]->count(); j < n; ++j) {
+        top_data[j] = std::max(top_data[j], Dtype(0));
+      }
+    }
   }
 }
 
@@ -45,6 +196,9 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
   const Dtype* weight = this->blobs_[0]->cpu_data();
   Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
   for (int i = 0; i < top.size(); ++i) {
+    if (fuse_relu_) {
+      fused_relu_backward_cpu(top[i]);
+    }
     const Dtype* top_diff = top[i]->cpu_diff();
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* bottom_diff = bottom[i]->mutable_cpu_diff();
@@ -90,7 +244,11 @@ void ConvolutionLayer<Dtype>::Backward_relevance(const vector<Blob<Dtype>*>& top
 {
 
     //recalculate z_ij, otherwise relu is applied
+    //(relevance passes through relu unchanged, so a fused one is skipped)
+    const bool fuse_relu = fuse_relu_;
+    fuse_relu_ = false;
     Forward_cpu(bottom, top);
+    fuse_relu_ = fuse_relu;
 
     /*
     Dtype top_sum = 0;
@@ -4,6 +4,39 @@
 
 namespace caffe {
 
+template <typename Dtype>
+__global__ void FusedReLUForward(const int n, Dtype* data) {
+  CUDA_KERNEL_LOOP(index, n) {
+    data[index] = data[index] > 0 ? data[index] : Dtype(0);
+  }
+}
+
+template <typename Dtype>
+__global__ void FusedReLUBackward(const int n, const Dtype* data,
+    Dtype* diff) {
+  CUDA_KERNEL_LOOP(index, n) {
+    diff[index] = data[index] > 0 ? diff[index] : Dtype(0);
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::fused_relu_forward_gpu(Blob<Dtype>* top) {
+  const int count = top->count();
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  FusedReLUForward<Dtype><<<CAFFE_GET_BLOCKS(count), CAFFE_CUDA_NUM_THREADS>>>(
+      count, top->mutable_gpu_data());
+  CUDA_POST_KERNEL_CHECK;
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::fused_relu_backward_gpu(Blob<Dtype>* top) {
+  const int count = top->count();
+  // NOLINT_NEXT_LINE(whitespace/operators)
+  FusedReLUBackward<Dtype><<<CAFFE_GET_BLOCKS(count), CAFFE_CUDA_NUM_THREADS>>>(
+      count, top->gpu_data(), top->mutable_gpu_diff());
+  CUDA_POST_KERNEL_CHECK;
+}
+
 template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
@@ -19,6 +52,9 @@ void ConvolutionLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
         this->forward_gpu_bias(top_data + n * this->top_dim_, bias);
       }
     }
+    if (fuse_relu_) {
+      fused_relu_forward_gpu(top[i]);
+    }
   }
 }
 
@@ -28,6 +64,9 @@ void ConvolutionLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
   const Dtype* weight = this->blobs_[0]->gpu_data();
   Dtype* weight_diff = this->blobs_[0]->mutable_gpu_diff();
   for (int i = 0; i < top.size(); ++i) {
+    if (fuse_relu_) {
+      fused_relu_backward_gpu(top[i]);
+    }
     const Dtype* top_diff = top[i]->gpu_diff();
     // Bias gradient, if necessary.
     if (this->bias_term_ && this->param_propagate_down_[1]) {
@@ -56,5 +95,10 @@ void ConvolutionLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
 }
 
 INSTANTIATE_LAYER_GPU_FUNCS(ConvolutionLayer);
+template void ConvolutionLayer<float>::fused_relu_forward_gpu(Blob<float>*);
+template void ConvolutionLayer<double>::fused_relu_forward_gpu(Blob<double>*);
+template void ConvolutionLayer<float>::fused_relu_backward_gpu(Blob<float>*);
+template void ConvolutionLayer<double>::fused_relu_backward_gpu(
+    Blob<double>*);
 
 }  // namespace caffe
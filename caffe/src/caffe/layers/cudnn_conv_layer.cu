@@ -42,6 +42,10 @@ void CuDNNConvolutionLayer<Dtype>::Forward_gpu(
     // stream, by launching an empty kernel into the default (null) stream.
     // NOLINT_NEXT_LINE(whitespace/operators)
     sync_conv_groups<<<1, 1>>>();
+
+    if (this->fuse_relu_) {
+      this->fused_relu_forward_gpu(top[i]);
+    }
   }
 }
 
@@ -59,6 +63,9 @@ void CuDNNConvolutionLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
     bias_diff = this->blobs_[1]->mutable_gpu_diff();
   }
   for (int i = 0; i < top.size(); ++i) {
+    if (this->fuse_relu_) {
+      this->fused_relu_backward_gpu(top[i]);
+    }
     const Dtype* top_diff = top[i]->gpu_diff();
     // Backward through cuDNN in parallel over groups and gradients.
     for (int g = 0; g < this->group_; g++) {
@@ -9,6 +9,8 @@
 #include <boost/iostreams/copy.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
 
 #include "caffe/data_transformer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
@@ -52,42 +54,61 @@ void NDimDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   const int batch_size = this->layer_param_.ndim_data_param().batch_size();
   CHECK_GT(batch_size, 0) << "Positive batch size required";
 
+  num_workers = std::max(1U, this->layer_param_.ndim_data_param().prefetch_threads());
+
   if(!this->layer_param_.ndim_data_param().inmemory())
   {
-		// Read the file with filenames and labels
 		const string& source = this->layer_param_.ndim_data_param().source();
-
-		LOG(INFO) << "Opening file " << source;
-		std::ifstream infile(source.c_str());
-		CHECK((bool)infile) << "Could not load " << source;
-
-
-		string line, fname;
-		vector<std::string> binmaps;
-
-		while (getline(infile, line)) {
-			stringstream example(line);
-			float label = 0;
-			//first the label
-			example >> label;
-			//then all binmaps for the example
-			binmaps.clear();
-
-			while(example >> fname) {
-				if(fname.length() > 0 && fname[0] == '#')
-					break; //ignore rest of line
-				binmaps.push_back(fname);
+		example_ref ex;
+
+		if(this->layer_param_.ndim_data_param().packed()) {
+			// Everything, including labels, is in the packed file
+			LOG(INFO) << "Mapping packed file " << source;
+			CHECK(pack_.open(source)) << "Could not load packed file " << source;
+
+			for(size_t i = 0, n = pack_.size(); i < n; i++) {
+				float label = pack_.label(i);
+				ex.packed_index = i;
+				all_.push_back(make_pair(ex,label));
+				if(label) actives_.push_back(ex);
+				else decoys_.push_back(ex);
+
+				if(label != 0.0 && label != 1.0) {
+					CHECK(!balanced) << "Non-binary labels with balanced set to true";
+				}
 			}
+		} else {
+			// Read the file with filenames and labels
+			LOG(INFO) << "Opening file " << source;
+			std::ifstream infile(source.c_str());
+			CHECK((bool)infile) << "Could not load " << source;
+
+			string line, fname;
+
+			while (getline(infile, line)) {
+				stringstream example(line);
+				float label = 0;
+				//first the label
+				example >> label;
+				//then all binmaps for the example
+				ex.files.clear();
+
+				while(example >> fname) {
+					if(fname.length() > 0 && fname[0] == '#')
+						break; //ignore rest of line
+					ex.files.push_back(fname);
+				}
 
-			if(binmaps.size() == 0) //ignore empty lines
-				continue;
+				if(ex.files.size() == 0) //ignore empty lines
+					continue;
 
-			all_.push_back(make_pair(binmaps,label));
-			if(label) actives_.push_back(binmaps);
-			else decoys_.push_back(binmaps);
+				all_.push_back(make_pair(ex,label));
+				if(label) actives_.push_back(ex);
+				else decoys_.push_back(ex);
 
-			if(label != 0.0 && label != 1.0) {
-			  CHECK(!balanced) << "Non-binary labels with balanced set to true";
+				if(label != 0.0 && label != 1.0) {
+					CHECK(!balanced) << "Non-binary labels with balanced set to true";
+				}
 			}
 		}
 
@@ -126,6 +147,9 @@ void NDimDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     top_shape.push_back(example_shape[i]);
     example_size *= example_shape[i];
   }
+  if(this->layer_param_.ndim_data_param().packed()) {
+    CHECK_EQ(pack_.example_size(), example_size) << "Packed examples do not match specified shape";
+  }
   //shape of single data
   this->transformed_data_.Reshape(top_shape);
 
@@ -156,7 +180,7 @@ void NDimDataLayer<Dtype>::Shuffle() {
 //copy raw floating point data from files into buffer
 //files should represent a single example
 template <typename Dtype>
-void  NDimDataLayer<Dtype>::load_data_from_files(Dtype* buffer, const std::string& root, const vector<std::string>& files)
+void  NDimDataLayer<Dtype>::load_data_from_files(Dtype* buffer, const std::string& root, const vector<std::string>& files, unsigned rot)
 {
   using namespace boost::iostreams;
 
@@ -198,8 +222,8 @@ void  NDimDataLayer<Dtype>::load_data_from_files(Dtype* buffer, const std::strin
 
   CHECK_EQ(total,example_size*sizeof(Dtype)) << "Incorrect size of inputs (" << total << " vs. " << example_size*sizeof(Dtype) << ") on " << files[0];
 
-  if(current_rotation > 0) {
-    rotate_data(buffer, current_rotation);
+  if(rot > 0) {
+    rotate_data(buffer, rot);
   }
   if( this->layer_param_.ndim_data_param().check()) {
     for(unsigned i = 0; i < example_size; i++) {
@@ -209,6 +233,42 @@ void  NDimDataLayer<Dtype>::load_data_from_files(Dtype* buffer, const std::strin
   }
 }
 
+//copy (and decompress if necessary) example index of the packed file into buffer
+template <typename Dtype>
+void  NDimDataLayer<Dtype>::load_data_from_pack(Dtype* buffer, size_t index, unsigned rot)
+{
+  CHECK_LT(index, pack_.size()) << "Invalid packed example " << index;
+  CHECK(pack_.read(index, buffer)) << "Incorrect size of packed example " << index;
+
+  if(rot > 0) {
+    rotate_data(buffer, rot);
+  }
+  if( this->layer_param_.ndim_data_param().check()) {
+    for(unsigned i = 0; i < example_size; i++) {
+      CHECK(finite(buffer[i])) << "Not finite value at " << i << " in packed example " << index;
+    }
+  }
+}
+
+template <typename Dtype>
+void NDimDataLayer<Dtype>::load_example(Dtype* buffer, const std::string& root, const example_ref& ex, unsigned rot)
+{
+  if(this->layer_param_.ndim_data_param().packed())
+    load_data_from_pack(buffer, ex.packed_index, rot);
+  else
+    load_data_from_files(buffer, root, ex.files, rot);
+}
+
+//load every num_workers-th example beginning with start into consecutive
+//examples of data; called from prefetch worker threads
+template <typename Dtype>
+void NDimDataLayer<Dtype>::load_examples(Dtype* data, const std::string& root, const vector<example_ref>& exs, const vector<unsigned>& rots, unsigned start)
+{
+  for(unsigned i = start, n = exs.size(); i < n; i += num_workers) {
+    load_example(data+i*example_size, root, exs[i], rots[i]);
+  }
+}
+
 static unsigned rotate_coords(unsigned i, unsigned j, unsigned k, const unsigned I, const unsigned J, const unsigned K,unsigned rot)
 {
   CHECK_LT(rot,24) << "Invalid rotation " << rot << " (must be <24)";
@@ -349,8 +409,6 @@ void NDimDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   CHECK(this->transformed_data_.count());
   unsigned batch_size = top_shape[0];
   CHECK_GT(batch_size, 0) << "Positive batch size required";
-  vector<int> offind(1, 0);
-
   batch->data_.Reshape(top_shape);
 
   Dtype* prefetch_data = batch->data_.mutable_cpu_data();
@@ -382,15 +440,19 @@ void NDimDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   	}
   }
   else {
+		//select examples serially since this updates positions and rotations;
+		//copy the references since reaching the end of a list reshuffles it
+		vector<example_ref> exs(batch_size);
+		vector<unsigned> rots(batch_size, 0);
+
 		if(balanced) { //load equally from actives/decoys
 			unsigned nactives = batch_size/2;
 
 			int item_id = 0;
 			unsigned asz = actives_.size();
 			for (item_id = 0; item_id < nactives; ++item_id) {
-				offind[0] = item_id;
-				int offset = batch->data_.offset(offind);
-				load_data_from_files(prefetch_data+offset, root_folder, actives_[actives_pos_]);
+				exs[item_id] = actives_[actives_pos_];
+				rots[item_id] = current_rotation;
 				prefetch_label[item_id] = 1;
 
 				actives_pos_++;
@@ -407,9 +469,8 @@ void NDimDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
 			}
 			unsigned dsz = decoys_.size();
 			for (; item_id < batch_size; ++item_id) {
-				offind[0] = item_id;
-				int offset = batch->data_.offset(offind);
-				load_data_from_files(prefetch_data+offset, root_folder, decoys_[decoys_pos_]);
+				exs[item_id] = decoys_[decoys_pos_];
+				rots[item_id] = current_rotation;
 				prefetch_label[item_id] = 0;
 
 				decoys_pos_++;
@@ -429,9 +490,8 @@ void NDimDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
 			//load from all
 			unsigned sz = all_.size();
 			for (int item_id = 0; item_id < batch_size; ++item_id) {
-				offind[0] = item_id;
-				int offset = batch->data_.offset(offind);
-				load_data_from_files(prefetch_data+offset, root_folder, all_[all_pos_].first);
+				exs[item_id] = all_[all_pos_].first;
+				rots[item_id] = current_rotation;
 				prefetch_label[item_id] = all_[all_pos_].second;
 
 				all_pos_++;
@@ -447,6 +507,20 @@ void NDimDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
 				}
 			}
 		}
+
+		//examples are contiguous in the batch, so load them in parallel
+		if(num_workers > 1) {
+			boost::thread_group workers;
+			for(unsigned t = 0; t < num_workers && t < batch_size; t++) {
+				workers.create_thread(boost::bind(&NDimDataLayer<Dtype>::load_examples, this,
+						prefetch_data, boost::cref(root_folder), boost::cref(exs), boost::cref(rots), t));
+			}
+			workers.join_all();
+		} else {
+			for(unsigned i = 0; i < batch_size; i++) {
+				load_example(prefetch_data+i*example_size, root_folder, exs[i], rots[i]);
+			}
+		}
   }
 
   batch_timer.Stop();
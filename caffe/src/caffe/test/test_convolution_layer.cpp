@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -440,6 +441,186 @@ TYPED_TEST(ConvolutionLayerTest, TestDilated3DConvolution) {
   }
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestDirect3DConvolutionReLU) {
+  // stride 1 padded cubic kernel, computed directly on the CPU
+  typedef typename TypeParam::Dtype Dtype;
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  vector<int> bottom_shape(5);
+  bottom_shape[0] = this->blob_bottom_vec_[0]->shape(0);
+  bottom_shape[1] = this->blob_bottom_vec_[0]->shape(1);
+  bottom_shape[2] = 6;
+  bottom_shape[3] = 7;
+  bottom_shape[4] = 11;
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  for (int i = 0; i < this->blob_bottom_vec_.size(); ++i) {
+    this->blob_bottom_vec_[i]->Reshape(bottom_shape);
+    filler.Fill(this->blob_bottom_vec_[i]);
+  }
+  LayerParameter layer_param;
+  layer_param.set_phase(TEST);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(10);  // not a multiple of the block size
+  convolution_param->set_fuse_relu(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Check against reference convolution followed by relu.
+  const Dtype* top_data;
+  const Dtype* ref_top_data;
+  for (int b = 0; b < 2; ++b) {
+    caffe_conv(this->blob_bottom_vec_[b], convolution_param, layer->blobs(),
+        this->MakeReferenceTop(this->blob_top_vec_[b]));
+    top_data = this->blob_top_vec_[b]->cpu_data();
+    ref_top_data = this->ref_blob_top_->cpu_data();
+    for (int i = 0; i < this->blob_top_vec_[b]->count(); ++i) {
+      EXPECT_NEAR(top_data[i], std::max(ref_top_data[i], Dtype(0)), 1e-4);
+    }
+  }
+  // Splitting the work over threads must not change the result.
+  vector<Dtype> single(this->blob_top_->cpu_data(),
+      this->blob_top_->cpu_data() + this->blob_top_->count());
+  Caffe::set_cpu_threads(3);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  Caffe::set_cpu_threads(1);
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_EQ(single[i], this->blob_top_->cpu_data()[i]);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestFusedReLUTrain) {
+  // training computes the same fused convolution through im2col
+  typedef typename TypeParam::Dtype Dtype;
+  vector<int> bottom_shape(5);
+  bottom_shape[0] = this->blob_bottom_->shape(0);
+  bottom_shape[1] = this->blob_bottom_->shape(1);
+  bottom_shape[2] = 4;
+  bottom_shape[3] = 4;
+  bottom_shape[4] = 4;
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  this->blob_bottom_->Reshape(bottom_shape);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  layer_param.set_phase(TRAIN);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(4);
+  convolution_param->set_fuse_relu(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer.blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], std::max(ref_top_data[i], Dtype(0)), 1e-4);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestSparse3DConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<int> bottom_shape(5);
+  bottom_shape[0] = this->blob_bottom_->shape(0);
+  bottom_shape[1] = this->blob_bottom_->shape(1);
+  bottom_shape[2] = 6;
+  bottom_shape[3] = 7;
+  bottom_shape[4] = 12;
+  this->blob_bottom_->Reshape(bottom_shape);
+  // a single small non-zero patch per channel
+  Dtype* bottom_data = this->blob_bottom_->mutable_cpu_data();
+  caffe_set(this->blob_bottom_->count(), Dtype(0), bottom_data);
+  for (int n = 0; n < bottom_shape[0]; ++n) {
+    for (int c = 0; c < bottom_shape[1]; ++c) {
+      for (int x = c; x < c + 3; ++x) {
+        bottom_data[this->blob_bottom_->offset(vector<int>{n, c, 2, 3, x})] =
+            Dtype(x + 1);
+      }
+    }
+  }
+  LayerParameter layer_param;
+  layer_param.set_phase(TEST);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(4);
+  convolution_param->set_sparse_input(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Check against reference convolution.
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestInt83DConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<int> bottom_shape(5);
+  bottom_shape[0] = this->blob_bottom_->shape(0);
+  bottom_shape[1] = this->blob_bottom_->shape(1);
+  bottom_shape[2] = 5;
+  bottom_shape[3] = 6;
+  bottom_shape[4] = 7;
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  this->blob_bottom_->Reshape(bottom_shape);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  layer_param.set_phase(TEST);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(4);
+  convolution_param->set_precision(ConvolutionParameter_Precision_INT8);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  shared_ptr<Layer<Dtype> > layer(
+      new ConvolutionLayer<Dtype>(layer_param));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Quantized result should be close to the reference convolution.
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 0.5);
+  }
+  // Quantized weights are cached, but must follow weight updates.
+  caffe_scal(layer->blobs()[0]->count(), Dtype(-2),
+      layer->blobs()[0]->mutable_cpu_data());
+  layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  caffe_conv(this->blob_bottom_, convolution_param, layer->blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  top_data = this->blob_top_->cpu_data();
+  ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1.0);
+  }
+}
+
 TYPED_TEST(ConvolutionLayerTest, Test1x1Convolution) {
   typedef typename TypeParam::Dtype Dtype;
   LayerParameter layer_param;
@@ -811,6 +992,48 @@ TYPED_TEST(ConvolutionLayerTest, TestGradientGroup) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestFusedReLUGradient) {
+  // the fused ReLU must mask the gradient where the output was clamped
+  typedef typename TypeParam::Dtype Dtype;
+  Caffe::set_random_seed(1702);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(this->blob_bottom_);
+  LayerParameter layer_param;
+  layer_param.set_phase(TRAIN);
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(2);
+  convolution_param->set_fuse_relu(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // finite differences are meaningless across the kink, so the outputs
+  // before the ReLU must be further from zero than a step can move them
+  convolution_param->set_fuse_relu(false);
+  ConvolutionLayer<Dtype> unfused(layer_param);
+  Blob<Dtype> pre;
+  vector<Blob<Dtype>*> pre_vec(1, &pre);
+  unfused.SetUp(this->blob_bottom_vec_, pre_vec);
+  for (int i = 0; i < layer.blobs().size(); ++i) {
+    unfused.blobs()[i]->CopyFrom(*layer.blobs()[i]);
+  }
+  unfused.Forward(this->blob_bottom_vec_, pre_vec);
+  int clamped = 0;
+  for (int i = 0; i < pre.count(); ++i) {
+    ASSERT_GT(std::abs(pre.cpu_data()[i]), 0.1);
+    clamped += pre.cpu_data()[i] < 0;
+  }
+  ASSERT_GT(clamped, 0);
+  ASSERT_LT(clamped, pre.count());
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
 #ifdef USE_CUDNN
 
 template <typename Dtype>
@@ -0,0 +1,164 @@
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/ndim_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/format.hpp"
+#include "caffe/util/io.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class NDimDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  NDimDataLayerTest()
+      : num_examples_(10),
+        channels_(2),
+        dim_(3),
+        blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    MakeTempDir(&dirname_);
+    // Example i is filled with value(i, k) and labeled i % 2, both as
+    // separate binmaps listed in a types file and in packed files.
+    source_ = dirname_ + "/examples.types";
+    std::ofstream types(source_.c_str());
+    gridpack_writer plain, gzipped;
+    packed_ = dirname_ + "/examples.gridpack";
+    packed_gz_ = dirname_ + "/examples_gz.gridpack";
+    ASSERT_TRUE(plain.open(packed_, channels_, dim_, 0.5, 1, false));
+    ASSERT_TRUE(gzipped.open(packed_gz_, channels_, dim_, 0.5, 1, true));
+    for (int i = 0; i < num_examples_; ++i) {
+      std::vector<float> data(example_size());
+      for (int k = 0; k < example_size(); ++k) {
+        data[k] = value(i, k);
+      }
+      std::vector<float> labels(1, i % 2);
+      std::string encoded;
+      gridpack_encode(&data[0], data.size(), false, encoded);
+      plain.append(encoded, labels);
+      gridpack_encode(&data[0], data.size(), true, encoded);
+      gzipped.append(encoded, labels);
+
+      // binmaps are read as raw Dtype
+      std::vector<Dtype> raw(data.begin(), data.end());
+      std::string fname = "ex" + format_int(i) + ".binmap";
+      std::ofstream out((dirname_ + "/" + fname).c_str(), std::ios::binary);
+      out.write(reinterpret_cast<const char*>(&raw[0]),
+          raw.size() * sizeof(Dtype));
+      types << i % 2 << " " << fname << "\n";
+    }
+    plain.close();
+    gzipped.close();
+  }
+
+  virtual ~NDimDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  int example_size() const { return channels_ * dim_ * dim_ * dim_; }
+  static float value(int example, int k) { return example * 1000 + k; }
+
+  void FillParam(LayerParameter* param, int prefetch_threads) {
+    NDimDataParameter* ndim_param = param->mutable_ndim_data_param();
+    ndim_param->set_batch_size(4);
+    ndim_param->set_shuffle(false);
+    ndim_param->set_balanced(false);
+    ndim_param->set_prefetch_threads(prefetch_threads);
+    BlobShape* shape = ndim_param->mutable_shape();
+    shape->add_dim(channels_);
+    shape->add_dim(dim_);
+    shape->add_dim(dim_);
+    shape->add_dim(dim_);
+  }
+
+  // Batches must hold the examples in types file order, wrapping around,
+  // no matter how many threads loaded them.
+  void CheckOrder(LayerParameter param) {
+    NDimDataLayer<Dtype> layer(param);
+    layer.SetUp(blob_bottom_vec_, blob_top_vec_);
+    EXPECT_EQ(blob_top_data_->num(), 4);
+    EXPECT_EQ(blob_top_data_->count(), 4 * example_size());
+    int next = 0;
+    for (int iter = 0; iter < 4; ++iter) {
+      layer.Forward(blob_bottom_vec_, blob_top_vec_);
+      const Dtype* data = blob_top_data_->cpu_data();
+      const Dtype* label = blob_top_label_->cpu_data();
+      for (int b = 0; b < 4; ++b, next = (next + 1) % num_examples_) {
+        EXPECT_EQ(next % 2, label[b]);
+        for (int k = 0; k < example_size(); ++k) {
+          ASSERT_EQ(value(next, k), data[b * example_size() + k])
+              << "batch " << iter << " item " << b;
+        }
+      }
+    }
+  }
+
+  int num_examples_;
+  int channels_;
+  int dim_;
+  string dirname_;
+  string source_;
+  string packed_;
+  string packed_gz_;
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(NDimDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(NDimDataLayerTest, TestReadFiles) {
+  LayerParameter param;
+  this->FillParam(&param, 1);
+  param.mutable_ndim_data_param()->set_source(this->source_);
+  param.mutable_ndim_data_param()->set_root_folder(this->dirname_ + "/");
+  this->CheckOrder(param);
+}
+
+TYPED_TEST(NDimDataLayerTest, TestReadFilesParallel) {
+  LayerParameter param;
+  this->FillParam(&param, 3);
+  param.mutable_ndim_data_param()->set_source(this->source_);
+  param.mutable_ndim_data_param()->set_root_folder(this->dirname_ + "/");
+  this->CheckOrder(param);
+}
+
+TYPED_TEST(NDimDataLayerTest, TestReadPacked) {
+  LayerParameter param;
+  this->FillParam(&param, 1);
+  param.mutable_ndim_data_param()->set_source(this->packed_);
+  param.mutable_ndim_data_param()->set_packed(true);
+  this->CheckOrder(param);
+}
+
+TYPED_TEST(NDimDataLayerTest, TestReadPackedParallel) {
+  LayerParameter param;
+  this->FillParam(&param, 3);
+  param.mutable_ndim_data_param()->set_source(this->packed_);
+  param.mutable_ndim_data_param()->set_packed(true);
+  this->CheckOrder(param);
+}
+
+TYPED_TEST(NDimDataLayerTest, TestReadPackedCompressedParallel) {
+  LayerParameter param;
+  this->FillParam(&param, 3);
+  param.mutable_ndim_data_param()->set_source(this->packed_gz_);
+  param.mutable_ndim_data_param()->set_packed(true);
+  this->CheckOrder(param);
+}
+
+}  // namespace caffe
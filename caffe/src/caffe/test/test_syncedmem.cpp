@@ -67,6 +67,20 @@ TEST_F(SyncedMemoryTest, TestCPUWrite) {
   }
 }
 
+TEST_F(SyncedMemoryTest, TestVersion) {
+  SyncedMemory mem(10);
+  const unsigned long initial = mem.version();
+  mem.cpu_data();
+  EXPECT_EQ(mem.version(), initial);
+  mem.mutable_cpu_data();
+  const unsigned long written = mem.version();
+  EXPECT_NE(written, initial);
+  mem.cpu_data();
+  EXPECT_EQ(mem.version(), written);
+  mem.clear();
+  EXPECT_NE(mem.version(), written);
+}
+
 #ifndef CPU_ONLY  // GPU test
 
 TEST_F(SyncedMemoryTest, TestGPURead) {
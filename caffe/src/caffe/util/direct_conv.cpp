@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+
+#include "caffe/common.hpp"
+#include "caffe/util/direct_conv.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// Number of consecutive output voxels along a row computed together.  With
+// kDirectConvOutputBlock output channels this gives a register tile of
+// accumulators that is reused for every input value loaded.
+static const int kDirectConvRowTile = 8;
+
+template <typename Dtype>
+void direct_conv3d_pack_weights(const Dtype* weight, const int num_output,
+    const int channels, const int kernel, Dtype* packed) {
+  const int OB = kDirectConvOutputBlock;
+  const int ksize = kernel * kernel * kernel;
+  const int blocks = (num_output + OB - 1) / OB;
+  for (int b = 0; b < blocks; ++b) {
+    for (int c = 0; c < channels; ++c) {
+      for (int k = 0; k < ksize; ++k) {
+        Dtype* dst = packed + ((b * channels + c) * ksize + k) * OB;
+        for (int o = 0; o < OB; ++o) {
+          const int oc = b * OB + o;
+          dst[o] = oc < num_output ?
+              weight[(oc * channels + c) * ksize + k] : Dtype(0);
+        }
+      }
+    }
+  }
+}
+
+// Accumulate one kernel row into a tile of output voxels.  If check is
+// false every input column touched is known to be in bounds.
+template <typename Dtype, bool check>
+static inline void direct_conv_row(const Dtype* row, const Dtype* w,
+    const int kernel, const int ix0, const int nx, const int width,
+    Dtype acc[kDirectConvRowTile][kDirectConvOutputBlock]) {
+  const int OB = kDirectConvOutputBlock;
+  for (int kx = 0; kx < kernel; ++kx) {
+    const Dtype* wk = w + kx * OB;
+    for (int t = 0; t < nx; ++t) {
+      const int ix = ix0 + t + kx;
+      if (check && static_cast<unsigned>(ix) >= static_cast<unsigned>(width)) {
+        continue;
+      }
+      const Dtype v = row[ix];
+      for (int o = 0; o < OB; ++o) {
+        acc[t][o] += v * wk[o];
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void direct_conv3d_row_extents(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width, int* extents) {
+  const int rows = channels * depth * height;
+  for (int r = 0; r < rows; ++r) {
+    const Dtype* row = data_im + r * width;
+    int lo = 0;
+    while (lo < width && row[lo] == 0) ++lo;
+    int hi = width;
+    while (hi > lo && row[hi - 1] == 0) --hi;
+    if (lo == hi) lo = hi = 0;
+    extents[2 * r] = lo;
+    extents[2 * r + 1] = hi;
+  }
+}
+
+template <typename Dtype>
+void direct_conv3d_cpu(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width,
+    const Dtype* packed_weight, const int num_output, const int kernel,
+    const int pad, const Dtype* bias, const bool relu, Dtype* data_out,
+    const int* extents) {
+  const int OB = kDirectConvOutputBlock;
+  const int XT = kDirectConvRowTile;
+  const int out_d = depth + 2 * pad - kernel + 1;
+  const int out_h = height + 2 * pad - kernel + 1;
+  const int out_w = width + 2 * pad - kernel + 1;
+  const int ksize = kernel * kernel * kernel;
+  const int blocks = (num_output + OB - 1) / OB;
+  const int tasks = blocks * out_d;
+
+#ifdef _OPENMP
+  const int nthreads = Caffe::cpu_threads();
+  #pragma omp parallel for schedule(static) num_threads(nthreads) \
+      if (nthreads > 1)
+#endif
+  for (int task = 0; task < tasks; ++task) {
+    const int b = task / out_d;
+    const int z = task % out_d;
+    const int nout = std::min(OB, num_output - b * OB);
+    const Dtype* wblock = packed_weight + b * channels * ksize * OB;
+    Dtype acc[XT][OB];
+
+    for (int y = 0; y < out_h; ++y) {
+      for (int x0 = 0; x0 < out_w; x0 += XT) {
+        const int nx = std::min(XT, out_w - x0);
+        const int ix0 = x0 - pad;
+        const bool interior = ix0 >= 0 && ix0 + nx - 1 + kernel - 1 < width;
+        for (int t = 0; t < XT; ++t) {
+          for (int o = 0; o < OB; ++o) {
+            acc[t][o] = (bias && o < nout) ? bias[b * OB + o] : Dtype(0);
+          }
+        }
+
+        for (int c = 0; c < channels; ++c) {
+          const Dtype* im = data_im + c * depth * height * width;
+          const Dtype* wc = wblock + c * ksize * OB;
+          for (int kz = 0; kz < kernel; ++kz) {
+            const int iz = z + kz - pad;
+            if (static_cast<unsigned>(iz) >= static_cast<unsigned>(depth)) {
+              continue;
+            }
+            for (int ky = 0; ky < kernel; ++ky) {
+              const int iy = y + ky - pad;
+              if (static_cast<unsigned>(iy) >= static_cast<unsigned>(height)) {
+                continue;
+              }
+              if (extents) {
+                // skip if the row is empty or its non-zero columns are
+                // outside [ix0, ix0 + nx - 1 + kernel - 1]
+                const int* ext = extents
+                    + 2 * ((c * depth + iz) * height + iy);
+                if (ext[0] == ext[1] || ext[1] <= ix0 ||
+                    ext[0] >= ix0 + nx + kernel - 1) {
+                  continue;
+                }
+              }
+              const Dtype* row = im + (iz * height + iy) * width;
+              const Dtype* w = wc + (kz * kernel + ky) * kernel * OB;
+              if (interior) {
+                direct_conv_row<Dtype, false>(row, w, kernel, ix0, nx, width,
+                    acc);
+              } else {
+                direct_conv_row<Dtype, true>(row, w, kernel, ix0, nx, width,
+                    acc);
+              }
+            }
+          }
+        }
+
+        for (int o = 0; o < nout; ++o) {
+          Dtype* out = data_out
+              + (((b * OB + o) * out_d + z) * out_h + y) * out_w + x0;
+          for (int t = 0; t < nx; ++t) {
+            out[t] = relu ? std::max(acc[t][o], Dtype(0)) : acc[t][o];
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+static float int8_scale(const Dtype* in, const int n) {
+  Dtype maxabs = 0;
+  for (int i = 0; i < n; ++i) {
+    maxabs = std::max(maxabs, Dtype(std::fabs(in[i])));
+  }
+  return maxabs > 0 ? maxabs / 127.0 : 1.0;
+}
+
+static inline int16_t quantize_int8(const float v, const float inv_scale) {
+  const long q = lrintf(v * inv_scale);
+  return std::min(127L, std::max(-127L, q));
+}
+
+template <typename Dtype>
+float direct_conv3d_int8_pack_input(const Dtype* data_im, const int channels,
+    const int depth, const int height, const int width, const int pad,
+    int16_t* packed) {
+  const int size = channels * depth * height * width;
+  const int pd = depth + 2 * pad;
+  const int ph = height + 2 * pad;
+  const int pw = width + 2 * pad;
+  const float scale = int8_scale(data_im, size);
+  const float inv = 1.0 / scale;
+  std::fill(packed, packed + pd * ph * pw * channels, 0);
+  for (int c = 0; c < channels; ++c) {
+    for (int z = 0; z < depth; ++z) {
+      for (int y = 0; y < height; ++y) {
+        const Dtype* row = data_im + ((c * depth + z) * height + y) * width;
+        int16_t* dst = packed
+            + (((z + pad) * ph + y + pad) * pw + pad) * channels + c;
+        for (int x = 0; x < width; ++x) {
+          dst[x * channels] = quantize_int8(row[x], inv);
+        }
+      }
+    }
+  }
+  return scale;
+}
+
+template <typename Dtype>
+void direct_conv3d_int8_pack_weights(const Dtype* weight,
+    const int num_output, const int channels, const int kernel,
+    int16_t* packed, float* scales) {
+  const int ksize = kernel * kernel * kernel;
+  for (int o = 0; o < num_output; ++o) {
+    const Dtype* w = weight + o * channels * ksize;
+    scales[o] = int8_scale(w, channels * ksize);
+    const float inv = 1.0 / scales[o];
+    for (int c = 0; c < channels; ++c) {
+      for (int k = 0; k < ksize; ++k) {
+        packed[(o * ksize + k) * channels + c] = quantize_int8(w[c * ksize + k],
+            inv);
+      }
+    }
+  }
+}
+
+static inline int32_t int8_dot(const int16_t* a, const int16_t* b,
+    const int n) {
+  int32_t sum = 0;
+  for (int i = 0; i < n; ++i) {
+    sum += int32_t(a[i]) * int32_t(b[i]);
+  }
+  return sum;
+}
+
+template <typename Dtype>
+void direct_conv3d_int8_cpu(const int16_t* packed_im, const int channels,
+    const int depth, const int height, const int width,
+    const int16_t* packed_weight, const int num_output, const int kernel,
+    const int pad, const float* out_scale, const Dtype* bias, const bool relu,
+    Dtype* data_out) {
+  const int ph = height + 2 * pad;
+  const int pw = width + 2 * pad;
+  const int out_d = depth + 2 * pad - kernel + 1;
+  const int out_h = ph - kernel + 1;
+  const int out_w = pw - kernel + 1;
+  // a kernel row spans kernel adjacent voxels, which are contiguous
+  const int rowlen = kernel * channels;
+  const int tasks = num_output * out_d;
+
+#ifdef _OPENMP
+  const int nthreads = Caffe::cpu_threads();
+  #pragma omp parallel for schedule(static) num_threads(nthreads) \
+      if (nthreads > 1)
+#endif
+  for (int task = 0; task < tasks; ++task) {
+    const int oc = task / out_d;
+    const int z = task % out_d;
+    const int16_t* w = packed_weight + oc * kernel * kernel * rowlen;
+    const Dtype scale = out_scale[oc];
+    const Dtype shift = bias ? bias[oc] : Dtype(0);
+    Dtype* out = data_out + (oc * out_d + z) * out_h * out_w;
+    for (int y = 0; y < out_h; ++y) {
+      for (int x = 0; x < out_w; ++x) {
+        int32_t sum = 0;
+        for (int kz = 0; kz < kernel; ++kz) {
+          for (int ky = 0; ky < kernel; ++ky) {
+            sum += int8_dot(packed_im + (((z + kz) * ph + y + ky) * pw + x)
+                * channels, w + (kz * kernel + ky) * rowlen, rowlen);
+          }
+        }
+        const Dtype v = sum * scale + shift;
+        out[y * out_w + x] = relu ? std::max(v, Dtype(0)) : v;
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void direct_conv1x1_cpu(const Dtype* data_im, const int channels,
+    const int spatial_dim, const Dtype* weight, const int num_output,
+    const Dtype* bias, const bool relu, Dtype* data_out) {
+  caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, num_output, spatial_dim,
+      channels, (Dtype)1., weight, data_im, (Dtype)0., data_out);
+  if (!bias && !relu) return;
+
+#ifdef _OPENMP
+  const int nthreads = Caffe::cpu_threads();
+  #pragma omp parallel for schedule(static) num_threads(nthreads) \
+      if (nthreads > 1)
+#endif
+  for (int oc = 0; oc < num_output; ++oc) {
+    Dtype* out = data_out + oc * spatial_dim;
+    const Dtype b = bias ? bias[oc] : Dtype(0);
+    for (int i = 0; i < spatial_dim; ++i) {
+      const Dtype v = out[i] + b;
+      out[i] = relu ? std::max(v, Dtype(0)) : v;
+    }
+  }
+}
+
+template void direct_conv3d_pack_weights<float>(const float* weight,
+    const int num_output, const int channels, const int kernel, float* packed);
+template void direct_conv3d_pack_weights<double>(const double* weight,
+    const int num_output, const int channels, const int kernel,
+    double* packed);
+
+template void direct_conv3d_row_extents<float>(const float* data_im,
+    const int channels, const int depth, const int height, const int width,
+    int* extents);
+template void direct_conv3d_row_extents<double>(const double* data_im,
+    const int channels, const int depth, const int height, const int width,
+    int* extents);
+
+template void direct_conv3d_cpu<float>(const float* data_im,
+    const int channels, const int depth, const int height, const int width,
+    const float* packed_weight, const int num_output, const int kernel,
+    const int pad, const float* bias, const bool relu, float* data_out,
+    const int* extents);
+template void direct_conv3d_cpu<double>(const double* data_im,
+    const int channels, const int depth, const int height, const int width,
+    const double* packed_weight, const int num_output, const int kernel,
+    const int pad, const double* bias, const bool relu, double* data_out,
+    const int* extents);
+
+template float direct_conv3d_int8_pack_input<float>(const float* data_im,
+    const int channels, const int depth, const int height, const int width,
+    const int pad, int16_t* packed);
+template float direct_conv3d_int8_pack_input<double>(const double* data_im,
+    const int channels, const int depth, const int height, const int width,
+    const int pad, int16_t* packed);
+
+template void direct_conv3d_int8_pack_weights<float>(const float* weight,
+    const int num_output, const int channels, const int kernel,
+    int16_t* packed, float* scales);
+template void direct_conv3d_int8_pack_weights<double>(const double* weight,
+    const int num_output, const int channels, const int kernel,
+    int16_t* packed, float* scales);
+
+template void direct_conv3d_int8_cpu<float>(const int16_t* packed_im,
+    const int channels, const int depth, const int height, const int width,
+    const int16_t* packed_weight, const int num_output, const int kernel,
+    const int pad, const float* out_scale, const float* bias, const bool relu,
+    float* data_out);
+template void direct_conv3d_int8_cpu<double>(const int16_t* packed_im,
+    const int channels, const int depth, const int height, const int width,
+    const int16_t* packed_weight, const int num_output, const int kernel,
+    const int pad, const float* out_scale, const double* bias,
+    const bool relu, double* data_out);
+
+template void direct_conv1x1_cpu<float>(const float* data_im,
+    const int channels, const int spatial_dim, const float* weight,
+    const int num_output, const float* bias, const bool relu, float* data_out);
+template void direct_conv1x1_cpu<double>(const double* data_im,
+    const int channels, const int spatial_dim, const double* weight,
+    const int num_output, const double* bias, const bool relu,
+    double* data_out);
+
+}  // namespace caffe
@@ -0,0 +1,39 @@
+#include "caffe/util/fuse_relu.hpp"
+
+namespace caffe {
+
+static bool CanFuseReLU(const LayerParameter& conv,
+    const LayerParameter& relu) {
+  if (conv.type() != "Convolution" || relu.type() != "ReLU") return false;
+  if (conv.convolution_param().fuse_relu()) return false;
+  if (conv.top_size() != 1 || relu.bottom_size() != 1 ||
+      relu.top_size() != 1) {
+    return false;
+  }
+  // must be in place on the convolution output
+  if (relu.bottom(0) != conv.top(0) || relu.top(0) != conv.top(0)) {
+    return false;
+  }
+  if (relu.relu_param().negative_slope() != 0) return false;
+  // phase rules on the relu alone would change which nets it appears in
+  if (relu.include_size() > 0 || relu.exclude_size() > 0) return false;
+  return true;
+}
+
+void FuseConvolutionReLU(NetParameter* param) {
+  NetParameter fused(*param);
+  fused.clear_layer();
+  for (int i = 0; i < param->layer_size(); ++i) {
+    const LayerParameter& layer = param->layer(i);
+    const int n = fused.layer_size();
+    if (n > 0 && CanFuseReLU(fused.layer(n - 1), layer)) {
+      fused.mutable_layer(n - 1)->mutable_convolution_param()->set_fuse_relu(
+          true);
+      continue;
+    }
+    fused.add_layer()->CopyFrom(layer);
+  }
+  param->Swap(&fused);
+}
+
+}  // namespace caffe
@@ -24,6 +24,7 @@
 #include <libmolgrid/cartesian_grid.h>
 
 #include "molgridder.h"
+#include "gridpacker.h"
 #include "molgetter.h"
 
 #include "gridoptions.h"
@@ -42,13 +43,30 @@ static bool parse_options(int argc, char *argv[], gridoptions& o) {
 
   options_description inputs("Input");
   inputs.add_options()("receptor,r",
-      value<std::string>(&o.receptorfile)->required(), "receptor file")
-  ("ligand,l", value<std::string>(&o.ligandfile)->required(), "ligand(s)")
+      value<std::string>(&o.receptorfile), "receptor file")
+  ("ligand,l", value<std::string>(&o.ligandfile), "ligand(s)")
   ("grid,g", value<std::vector<std::string> >(&o.usergrids)->multitoken(),
       "additional grid(s) in dx format; prepended to receptor grids")
   ("example_grid", value<string>(&o.examplegrid),
       "example grid for positioning with --separate");
 
+  options_description batch("Batch (instead of receptor and ligand)");
+  batch.add_options()
+  ("types", value<std::string>(&o.typesfile),
+      "types file of examples to grid into a single packed file named by --out")
+  ("data_root", value<std::string>(&o.data_root),
+      "common path prefix for files in types file")
+  ("recmolcache", value<std::string>(&o.recmolcache),
+      "molcache of receptor structures")
+  ("ligmolcache", value<std::string>(&o.ligmolcache),
+      "molcache of ligand structures")
+  ("num_labels", value<int>(&o.num_labels)->default_value(1),
+      "number of numerical labels on each line of types file")
+  ("compress", bool_switch(&o.compress),
+      "gzip each example in packed file")
+  ("cpu", value<int>(&o.cpu),
+      "number of threads to use (default all available)");
+
   options_description outputs("Output");
   outputs.add_options()("out,o", value<std::string>(&o.outname)->required(),
       "output file name base, combined map of both lig and receptor")
@@ -81,7 +99,7 @@ static bool parse_options(int argc, char *argv[], gridoptions& o) {
       "Adjust the verbosity of the output, default: 1");
 
   options_description desc;
-  desc.add(inputs).add(options).add(outputs).add(info);
+  desc.add(inputs).add(batch).add(options).add(outputs).add(info);
   variables_map vm;
   try {
     store(
@@ -101,6 +119,22 @@ static bool parse_options(int argc, char *argv[], gridoptions& o) {
     }
 
     notify(vm);
+
+    if (o.typesfile.size() == 0
+        && (o.receptorfile.size() == 0 || o.ligandfile.size() == 0)) {
+      throw boost::program_options::error("receptor and ligand are required without --types");
+    }
+    if (o.typesfile.size() > 0) {
+      //batch mode only writes the packed file
+      const char* unsupported[] = { "gpu", "separate", "map", "dx",
+          "example_grid", "grid", "receptor", "ligand" };
+      for (const char* opt : unsupported) {
+        if (vm.count(opt) && !vm[opt].defaulted()) {
+          throw boost::program_options::error(
+              std::string("--") + opt + " is not supported with --types");
+        }
+      }
+    }
   } catch (boost::program_options::error& e) {
     std::cerr << "Command line parse error: " << e.what() << '\n'
         << "\nCorrect usage:\n" << desc << '\n';
@@ -119,6 +153,17 @@ int main(int argc, char *argv[]) {
     if (!parse_options(argc, argv, opt)) exit(0);
 
     srand(opt.seed);
+
+    if (opt.typesfile.size() > 0) {
+      //batch mode, everything goes in one file
+      GridPacker packer(opt);
+      size_t n = packer.run(opt.timeit);
+      if (opt.verbosity > 0) {
+        cout << "Wrote " << n << " examples to " << opt.outname << "\n";
+      }
+      return 0;
+    }
+
     MolGridder mgrid(opt); //initialize gridder
 
     //if separate, output receptor
@@ -152,5 +197,8 @@ int main(int argc, char *argv[]) {
     std::cerr << "\n\nError: could not open \"" << e.name.string() << "\" for "
         << (e.in ? "reading" : "writing") << ".\n";
     return -1;
+  } catch (usage_error& e) {
+    std::cerr << "\n\nUsage error: " << e.what() << "\n";
+    return -1;
   }
 }
@@ -0,0 +1,158 @@
+/*
+ * gridpacker.cpp
+ *
+ * Batch mode for gninagrid.  Examples are read serially (this is cheap with
+ * gninatypes or molcaches), but gridding and compression are done on
+ * all available threads a chunk at a time and results are appended to the
+ * gridpack file in the order of the types file.
+ */
+
+#include "gridpacker.h"
+#include <libmolgrid/managed_grid.h>
+#include <libmolgrid/libmolgrid.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/bind.hpp>
+#include <boost/timer/timer.hpp>
+
+using namespace std;
+using namespace libmolgrid;
+
+//examples gridded per thread per chunk, bounds memory use
+#define PACK_EXAMPLES_PER_THREAD 4
+
+//examples handed from the reading thread to the workers
+struct pack_chunk {
+    vector<Example> exs;
+    vector<Transform> transforms;
+    vector<string> encoded;
+    unsigned n; //examples in this chunk, none means stop
+    boost::barrier ready; //chunk filled in
+    boost::barrier done; //chunk gridded
+    pack_chunk(unsigned size, unsigned nthreads) :
+        exs(size), transforms(size), encoded(size), n(0),
+        ready(nthreads + 1), done(nthreads + 1) {
+    }
+};
+
+static ExampleProviderSettings settings_from_options(const gridoptions& opt) {
+  ExampleProviderSettings ret;
+  ret.shuffle = false;
+  ret.balanced = false;
+  ret.stratify_receptor = false;
+  ret.cache_structs = false; //every example is only visited once
+  ret.data_root = opt.data_root;
+  ret.recmolcache = opt.recmolcache;
+  ret.ligmolcache = opt.ligmolcache;
+  return ret;
+}
+
+GridPacker::GridPacker(const gridoptions& opt) :
+    gmaker(opt.res, opt.dim), random_translate(opt.randtranslate),
+    random_rotate(opt.randrotate), compress(opt.compress) {
+
+  if (opt.usergrids.size() > 0 || opt.examplegrid.size() > 0) {
+    throw usage_error("User and example grids are not supported with --types");
+  }
+  if (opt.separate || opt.outmap || opt.outdx) {
+    throw usage_error("Only packed output is supported with --types");
+  }
+  if (opt.spherize || opt.subgrid_dim > 0 || opt.use_covalent_radius) {
+    throw usage_error("Subgrids, spherized grids and covalent radii are not supported with --types");
+  }
+
+  rectyper = std::make_shared<FileMappedGninaTyper>(defaultGninaReceptorTyper);
+  ligtyper = std::make_shared<FileMappedGninaTyper>(defaultGninaLigandTyper);
+  if (opt.recmap.size() > 0) {
+    rectyper = std::make_shared<FileMappedGninaTyper>(opt.recmap);
+  }
+  if (opt.ligmap.size() > 0) {
+    ligtyper = std::make_shared<FileMappedGninaTyper>(opt.ligmap);
+  }
+
+  //transforms are drawn from libmolgrid's generator, in types file order
+  set_random_seed(opt.seed);
+
+  gmaker.set_binary(opt.binary);
+  N = gmaker.get_grid_dims().x;
+  channels = rectyper->num_types() + ligtyper->num_types();
+
+  provider = ExampleProvider(settings_from_options(opt), rectyper, ligtyper);
+  provider.populate(opt.typesfile, opt.num_labels);
+
+  nthreads = opt.cpu > 0 ? opt.cpu : boost::thread::hardware_concurrency();
+  if (nthreads < 1) nthreads = 1;
+
+  if (!writer.open(opt.outname, channels, N, opt.res, opt.num_labels,
+      compress)) {
+    throw file_error(opt.outname, false);
+  }
+}
+
+void GridPacker::grid_examples(unsigned start, pack_chunk& chunk) const {
+  GridMaker gm(gmaker); //private copy for this thread
+  MGrid4f grid(channels, N, N, N);
+  for (;;) {
+    chunk.ready.wait();
+    if (chunk.n == 0) return;
+    for (unsigned i = start; i < chunk.n; i += nthreads) {
+      gm.forward(chunk.exs[i], chunk.transforms[i], grid.cpu());
+      gridpack_encode(grid.cpu().data(), grid.size(), compress,
+          chunk.encoded[i]);
+    }
+    chunk.done.wait();
+  }
+}
+
+size_t GridPacker::run(bool timeit) {
+  boost::timer::cpu_timer t;
+  size_t total = provider.size();
+  pack_chunk chunk(nthreads * PACK_EXAMPLES_PER_THREAD, nthreads);
+
+  //workers live for the whole run and are handed one chunk at a time
+  boost::thread_group threads;
+  for (unsigned t = 0; t < nthreads; t++) {
+    threads.create_thread(
+        boost::bind(&GridPacker::grid_examples, this, t, boost::ref(chunk)));
+  }
+
+  try {
+    for (size_t pos = 0; pos < total; pos += chunk.n) {
+      chunk.n = min((size_t) chunk.exs.size(), total - pos);
+
+      //example reading and random transforms are not thread safe
+      for (unsigned i = 0; i < chunk.n; i++) {
+        provider.next(chunk.exs[i]);
+        if (chunk.exs[i].sets.size() == 0) {
+          throw usage_error("Empty example in types file");
+        }
+        gfloat3 center = chunk.exs[i].sets.back().center(); //ligand defines center
+        chunk.transforms[i] = Transform(center, random_translate,
+            random_rotate);
+      }
+
+      chunk.ready.wait();
+      chunk.done.wait();
+
+      for (unsigned i = 0; i < chunk.n; i++) {
+        writer.append(chunk.encoded[i], chunk.exs[i].labels);
+      }
+    }
+  } catch (...) {
+    //workers are waiting for a chunk, let them finish first
+    chunk.n = 0;
+    chunk.ready.wait();
+    threads.join_all();
+    throw;
+  }
+  chunk.n = 0;
+  chunk.ready.wait();
+  threads.join_all();
+  writer.close();
+
+  if (timeit) {
+    cout << "Pack Time: " << t.elapsed().wall << " (" << total
+        << " examples)\n";
+  }
+  return total;
+}
@@ -0,0 +1,48 @@
+/*
+ * gridpacker.h
+ *
+ * Batch mode for gninagrid: read a types file of examples, grid them in
+ * parallel and write everything into a single gridpack file.
+ */
+
+#ifndef GRIDPACKER_H_
+#define GRIDPACKER_H_
+
+#include <libmolgrid/example_provider.h>
+#include <libmolgrid/atom_typer.h>
+#include <libmolgrid/grid_maker.h>
+#include <libmolgrid/transform.h>
+#include <vector>
+#include <string>
+#include "file.h"
+#include "gridoptions.h"
+#include "gridpack.h"
+
+struct pack_chunk;
+
+class GridPacker {
+    std::shared_ptr<libmolgrid::AtomTyper> rectyper;
+    std::shared_ptr<libmolgrid::AtomTyper> ligtyper;
+    libmolgrid::ExampleProvider provider;
+    libmolgrid::GridMaker gmaker;
+    gridpack_writer writer;
+
+    float random_translate = 0.0;
+    bool random_rotate = false;
+    bool compress = false;
+    unsigned nthreads = 1;
+    unsigned N = 0; //number of points on each side
+    unsigned channels = 0;
+
+    //worker thread: grid and encode every nthreads-th example of each chunk
+    //beginning with start until an empty chunk is posted
+    void grid_examples(unsigned start, pack_chunk& chunk) const;
+
+  public:
+    GridPacker(const gridoptions& opt);
+
+    //grid every example, return number of examples written
+    size_t run(bool timeit);
+};
+
+#endif /* GRIDPACKER_H_ */
@@ -5,17 +5,31 @@
  *      Author: dkoes
  *
  *  Converts a (single) molecule into a binary file of x,y,z,smina atom type (NOT cnn types)
+ *
+ *  If the output file ends in .molcache2, all molecules of all inputs are
+ *  typed by worker processes into a single indexed molcache2 file
+ *  that can be used as a recmolcache/ligmolcache.
  */
 
 #include <iostream>
 #include <string>
 #include <algorithm>
 #include <fstream>
+#include <vector>
 
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/unordered_map.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/bind.hpp>
+#include <boost/program_options.hpp>
 #include <openbabel/oberror.h>
+#include <cstdio>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "atom_type.h"
 #include "obmolopener.h"
@@ -33,33 +47,287 @@ struct atom_info {
 	atom_info(float X, float Y, float Z, int T): x(X), y(Y), z(Z), type(T) {}
 };
 
+//molcache2 format: int version (-1), size_t offset of index, then for each
+//molecule an int number of atoms followed by that many atom_info; the index
+//is a list of length prefixed names each followed by the size_t offset of
+//the molecule's data
+class molcache_writer {
+	ofstream out;
+	vector<pair<string, size_t> > index;
+	boost::mutex lock;
+
+public:
+	bool open(const string& fname) {
+		out.open(fname.c_str(), ios::binary);
+		int version = -1;
+		size_t start = 0; //filled in on close
+		out.write((char*)&version, sizeof(int));
+		out.write((char*)&start, sizeof(size_t));
+		out.flush(); //nothing buffered is copied into forked workers
+		return (bool)out;
+	}
+
+	//thread safe
+	void add(const string& name, const vector<atom_info>& atoms) {
+		boost::lock_guard<boost::mutex> guard(lock);
+		size_t offset = out.tellp();
+		int natoms = atoms.size();
+		out.write((char*)&natoms, sizeof(int));
+		out.write((char*)atoms.data(), sizeof(atom_info)*natoms);
+		index.push_back(make_pair(name, offset));
+	}
+
+	void close() {
+		size_t start = out.tellp();
+		for(unsigned i = 0, n = index.size(); i < n; i++) {
+			unsigned char len = index[i].first.length();
+			out.write((char*)&len, 1);
+			out.write(index[i].first.c_str(), len);
+			out.write((char*)&index[i].second, sizeof(size_t));
+		}
+		out.seekp(sizeof(int));
+		out.write((char*)&start, sizeof(size_t));
+		out.close();
+	}
+};
+
+static void type_molecule(OBMol& mol, vector<atom_info>& atoms)
+{
+	mol.AddHydrogens();
+	atoms.clear();
+	atoms.reserve(mol.NumAtoms());
+	FOR_ATOMS_OF_MOL(a, mol)
+	{
+		smt t = obatom_to_smina_type(*a);
+		atoms.push_back(atom_info(a->x(), a->y(), a->z(), t));
+	}
+}
+
+//read every molecule of inputs, keyed by the path a types file would use for
+//it if it had been typed into a separate file next to its input
+//(dir/title_N.gninatypes), relative to data_root if given; every stride'th
+//molecule, starting with the first'th, is typed and written to out as a
+//length prefixed key followed by its number of atoms and the atoms
+static void type_inputs(const vector<string>& inputs, const string& data_root,
+		unsigned stride, unsigned first, FILE *out)
+{
+	boost::unordered_map<string, int> molcnts;
+	filesystem::path root(data_root);
+	vector<atom_info> atoms;
+	size_t cnt = 0;
+
+	for(unsigned f = 0, nf = inputs.size(); f < nf; f++) {
+		OBConversion conv;
+		obmol_opener opener;
+		opener.openForInput(conv, inputs[f]);
+
+		filesystem::path p(inputs[f]);
+		if(algorithm::ends_with(inputs[f],".gz"))
+			p.replace_extension("");
+		bool issdf = p.extension() == ".sdf";
+		p.replace_extension("");
+		filesystem::path dir = p.parent_path();
+		if(!root.empty()) {
+			//strip data_root so keys match relative types file paths
+			filesystem::path rel;
+			filesystem::path::iterator r = root.begin(), d = dir.begin();
+			while(r != root.end() && d != dir.end() && *r == *d) {
+				++r;
+				++d;
+			}
+			if(r == root.end()) {
+				for(; d != dir.end(); ++d)
+					rel /= *d;
+				dir = rel;
+			}
+		}
+
+		OBMol mol;
+		string name;
+		std::istream* in = conv.GetInStream();
+		while(*in) {
+			while(conv.Read(&mol)) {
+				name = mol.GetTitle();
+				if(name.length() == 0) name = p.filename().string();
+				string key = (dir / name).generic_string();
+				string molname = key + "_" + lexical_cast<string>(molcnts[key]++) + ".gninatypes";
+				if(molname.length() > 255) {
+					if(first == 0) cerr << "Molecule name too long for molcache: " << molname << "\n";
+					exit(1);
+				}
+				if(cnt++ % stride != first) continue;
+
+				type_molecule(mol, atoms);
+				unsigned char len = molname.length();
+				int natoms = atoms.size();
+				fwrite(&len, 1, 1, out);
+				fwrite(molname.c_str(), 1, len, out);
+				fwrite(&natoms, sizeof(int), 1, out);
+				fwrite(atoms.data(), sizeof(atom_info), natoms, out);
+			}
+
+			if(issdf && *in) { //tolerate molecular errors
+				string line;
+				while(getline(*in, line)) {
+					if(line == "$$$$")
+						break;
+				}
+				if(*in && first == 0) cerr << "Encountered invalid molecule after " << name << "; trying to recover\n";
+			}
+		}
+	}
+}
+
+//add the molecules a worker writes to fd to out until the worker is done
+static void collect_molecules(int fd, molcache_writer *out)
+{
+	FILE *in = fdopen(fd, "rb");
+	vector<atom_info> atoms;
+	unsigned char len = 0;
+	char key[256];
+	int natoms = 0;
+	while(fread(&len, 1, 1, in) == 1) {
+		if(fread(key, 1, len, in) != len || fread(&natoms, sizeof(int), 1, in) != 1)
+			break;
+		atoms.resize(natoms);
+		if(fread(atoms.data(), sizeof(atom_info), natoms, in) != size_t(natoms))
+			break;
+		out->add(string(key, len), atoms);
+	}
+	fclose(in);
+}
+
+//type every molecule of inputs into a single molcache2 file; OpenBabel keeps
+//global perception state and is not thread safe, so the typing is done by
+//nworkers forked processes, each of which reads all of the inputs (the keys
+//depend on every title before a molecule) and types its own stride of them
+static void create_molcache(const vector<string>& inputs, const string& outname,
+		unsigned nworkers, const string& data_root)
+{
+	molcache_writer out;
+	if(!out.open(outname)) {
+		cerr << "Error opening output file " << outname << "\n";
+		exit(1);
+	}
+
+	vector<int> fds;
+	vector<pid_t> workers;
+	for(unsigned w = 0; w < nworkers; w++) {
+		int p[2];
+		if(pipe(p) != 0) {
+			perror("pipe");
+			exit(1);
+		}
+		pid_t pid = fork();
+		if(pid < 0) {
+			perror("fork");
+			exit(1);
+		}
+		if(pid == 0) {
+			close(p[0]);
+			for(unsigned i = 0; i < fds.size(); i++)
+				close(fds[i]);
+			FILE *f = fdopen(p[1], "wb");
+			type_inputs(inputs, data_root, nworkers, w, f);
+			_exit(fclose(f) == 0 ? 0 : 1);
+		}
+		close(p[1]);
+		fds.push_back(p[0]);
+		workers.push_back(pid);
+	}
+
+	boost::thread_group threads;
+	for(unsigned i = 0; i < fds.size(); i++)
+		threads.create_thread(boost::bind(collect_molecules, fds[i], &out));
+	threads.join_all();
+
+	bool failed = false;
+	for(unsigned i = 0; i < workers.size(); i++) {
+		int status = 0;
+		if(waitpid(workers[i], &status, 0) != workers[i] || !WIFEXITED(status)
+				|| WEXITSTATUS(status) != 0)
+			failed = true;
+	}
+	out.close();
+	if(failed) {
+		cerr << "Typing failed, " << outname << " is incomplete\n";
+		exit(1);
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	OpenBabel::obErrorLog.StopLogging();
 
-	if(argc < 2) {
-		cerr << "Need input (and output) file." << "\n";
+	using namespace boost::program_options;
+	vector<string> files;
+	int cpu = 0;
+	string data_root;
+	options_description desc("gninatyper input [output]\n"
+			"gninatyper input... output.molcache2\nOptions");
+	desc.add_options()
+	("cpu", value<int>(&cpu), "number of worker processes for .molcache2 output (default all available)")
+	("data_root", value<string>(&data_root), "make .molcache2 keys relative to this directory")
+	("help", "display usage summary");
+	options_description hidden;
+	hidden.add_options()("files", value<vector<string> >(&files), "inputs and output");
+	options_description all;
+	all.add(desc).add(hidden);
+	positional_options_description positional;
+	positional.add("files", -1);
+
+	variables_map vm;
+	try {
+		store(command_line_parser(argc, argv).options(all).positional(positional).run(), vm);
+		notify(vm);
+		if(vm.count("help")) {
+			cout << desc << "\n";
+			return 0;
+		}
+		if(files.size() < 1) {
+			throw boost::program_options::error("Need input (and output) file.");
+		}
+		bool molcache = files.size() >= 2 && algorithm::ends_with(files.back(), ".molcache2");
+		if(!molcache && files.size() > 2) {
+			throw boost::program_options::error("Multiple inputs are only supported when creating a .molcache2");
+		}
+		if(!molcache && (vm.count("cpu") || vm.count("data_root"))) {
+			throw boost::program_options::error("--cpu and --data_root are only supported when creating a .molcache2");
+		}
+		if(cpu < 0) {
+			throw boost::program_options::error("--cpu must be positive");
+		}
+	} catch(boost::program_options::error& e) {
+		cerr << "Command line parse error: " << e.what() << "\n\nCorrect usage:\n" << desc << "\n";
 		exit(-1);
 	}
 
+	if(files.size() >= 2 && algorithm::ends_with(files.back(), ".molcache2")) {
+		string outname = files.back();
+		files.pop_back();
+		unsigned nworkers = cpu > 0 ? cpu : boost::thread::hardware_concurrency();
+		create_molcache(files, outname, max(nworkers, 1U), data_root);
+		return 0;
+	}
+
 	OBConversion conv;
 	obmol_opener opener;
-	opener.openForInput(conv, argv[1]);
+	opener.openForInput(conv, files[0]);
 
-	if(argc >= 3)
+	if(files.size() >= 2)
 	{
-		if(algorithm::ends_with(argv[2],".gninatypes"))
+		if(algorithm::ends_with(files[1],".gninatypes"))
 		{
-			ofstream out(argv[2]);
+			ofstream out(files[1].c_str());
 			if(!out) {
-				cerr << "Error opening output file " << argv[2] << "\n";
+				cerr << "Error opening output file " << files[1] << "\n";
 				exit(1);
 			}
 			//convert only the first molecule
 			OBMol mol;
 			conv.Read(&mol);
 			if(mol.NumAtoms() == 0) {
-				cerr << "Problem reading molecule " << argv[1] << "\n";
+				cerr << "Problem reading molecule " << files[0] << "\n";
 				exit(1);
 			}
 			mol.AddHydrogens();
@@ -74,8 +342,8 @@ int main(int argc, char *argv[])
 		else
 		{
 			//convert all molecules, generating output file names using provided base name
-			filesystem::path p(argv[1]);
-			if (algorithm::ends_with(argv[1], ".gz"))
+			filesystem::path p(files[0]);
+			if (algorithm::ends_with(files[0], ".gz"))
 				p.replace_extension("");
 			bool issdf = p.extension() == ".sdf";
 			OBMol mol;
@@ -86,7 +354,7 @@ int main(int argc, char *argv[])
 				while (conv.Read(&mol))
 				{
 					mol.AddHydrogens();
-					string base(argv[2]);
+					string base(files[1]);
 					string outname = base + "_" + lexical_cast<string>(cnt) + ".gninatypes";
 					ofstream out(outname.c_str());
 					if (!out)
@@ -120,8 +388,8 @@ int main(int argc, char *argv[])
 	{
 		//if only input file is specified, auto generate output file name and
 		//also handle multiple molecules
-		filesystem::path p(argv[1]);
-		if(algorithm::ends_with(argv[1],".gz"))
+		filesystem::path p(files[0]);
+		if(algorithm::ends_with(files[0],".gz"))
 			p.replace_extension("");
 		//strip extension
 		bool issdf = p.extension() == ".sdf";
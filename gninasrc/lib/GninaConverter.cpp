@@ -22,19 +22,26 @@ namespace GninaConverter {
 using namespace OpenBabel;
 using namespace std;
 
-MCMolConverter::MCMolConverter(OpenBabel::OBMol& m)
+MCMolConverter::MCMolConverter(OpenBabel::OBMol& m, bool rigid, bool addH)
     : mol(m) {
   //precompute fragments and tree
   int nc = mol.NumConformers();
   mol.SetConformer(0);
-  mol.AddHydrogens();
-
+  //same preparation as convertParsing
+  if (addH) mol.AddHydrogens();
+  mol.PerceiveBondOrders();
+  mol.SetAromaticPerceived();
   mol.SetAutomaticFormalCharge(false);
   DeleteHydrogens(mol); //leaves just polars
   if (mol.NumAtoms() == 0) return;
 
+  vector<int> norotate;
+  if (rigid)
+    for (unsigned i = 1; i <= mol.NumAtoms(); i++)
+      norotate.push_back(i);
+
   //we kind of assume a connected molecule
-  unsigned best_root_atom = FindFragments(mol, rigid_fragments);
+  unsigned best_root_atom = FindFragments(mol, rigid_fragments, 0, norotate);
   torsdof = rigid_fragments.size() - 1;
 
   unsigned int root_piece = 0;
@@ -58,10 +65,7 @@ void MCMolConverter::convertConformer(unsigned conf, std::ostream& out) {
   parsing_struct p;
   context c;
 
-  mol.SetConformer(conf);
-
-  std::map<unsigned int, obbranch> tmptree(tree); //tree gets modified by outputtree
-  OutputTree(mol, c, p, tmptree, torsdof);
+  convertConformer(conf, p, c);
 
   boost::iostreams::filtering_stream<boost::iostreams::output> strm;
   strm.push(boost::iostreams::gzip_compressor());
@@ -75,6 +79,15 @@ void MCMolConverter::convertConformer(unsigned conf, std::ostream& out) {
   serialout << c;
 }
 
+unsigned MCMolConverter::convertConformer(unsigned conf, parsing_struct& p,
+    context& c) {
+  mol.SetConformer(conf);
+
+  std::map<unsigned int, obbranch> tmptree(tree); //tree gets modified by outputtree
+  OutputTree(mol, c, p, tmptree, torsdof);
+  return torsdof;
+}
+
 //sets up data structures used by both text and binary
 //we link with gnina to ensure compatibility
 //rootatom, an obatom index (starting at 1) can be specified, if not
@@ -40,9 +40,15 @@ class MCMolConverter {
     std::map<unsigned int, obbranch> tree;
     unsigned torsdof;
   public:
-    MCMolConverter(OpenBabel::OBMol& m);
+    //if rigid, no bonds rotate and each conformer is a single rigid body
+    MCMolConverter(OpenBabel::OBMol& m, bool rigid = false, bool addH = true);
     //output smina data for specified conformer
     void convertConformer(unsigned c, std::ostream& out);
+    //smina parsing struct and context for specified conformer; return numtors
+    unsigned convertConformer(unsigned c, parsing_struct& p, context& ctx);
+    unsigned numConformers() {
+      return mol.NumConformers();
+    }
 };
 }
 ;
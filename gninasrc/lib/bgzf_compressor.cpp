@@ -0,0 +1,181 @@
+/*
+ * bgzf_compressor.cpp
+ *
+ * Block compression and the worker threads behind bgzf_compressor.
+ */
+
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/crc.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include "bgzf_compressor.h"
+
+//uncompressed bytes per block; small enough that a block of incompressible
+//data still fits the 16 bit size field, as in samtools
+static const std::streamsize block_size = 0xff00;
+//compressed blocks waiting to be written, per worker thread
+static const unsigned queued_per_thread = 4;
+
+//empty block that marks a complete BGZF file
+static const char eof_block[28] = { 0x1f, char(0x8b), 8, 4, 0, 0, 0, 0, 0,
+    char(0xff), 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static void put_le(std::string& out, unsigned long v, unsigned bytes) {
+  for (unsigned i = 0; i < bytes; i++)
+    out.push_back(char((v >> (8 * i)) & 0xff));
+}
+
+//replace data with it as one BGZF block
+static void compress_block(std::string& data, int level) {
+  std::string deflated;
+  {
+    boost::iostreams::zlib_params params(level);
+    params.noheader = true; //raw deflate, the gzip wrapper is written here
+    boost::iostreams::filtering_ostream out;
+    out.push(boost::iostreams::zlib_compressor(params));
+    out.push(boost::iostreams::back_inserter(deflated));
+    out.write(data.data(), data.size());
+  }
+  boost::crc_32_type crc;
+  crc.process_bytes(data.data(), data.size());
+
+  std::string block;
+  block.reserve(deflated.size() + 26);
+  const char header[12] = { 0x1f, char(0x8b), 8, 4, 0, 0, 0, 0, 0,
+      char(0xff), 6, 0 };
+  block.append(header, sizeof(header));
+  block.append("BC", 2);
+  put_le(block, 2, 2);
+  put_le(block, deflated.size() + 25, 2); //total block size - 1
+  block.append(deflated);
+  put_le(block, crc.checksum(), 4);
+  put_le(block, data.size(), 4);
+  data.swap(block);
+}
+
+class bgzf_blocks {
+    struct block {
+        std::string data; //uncompressed until done
+        bool done;
+        block()
+            : done(false) {
+        }
+    };
+    typedef boost::shared_ptr<block> block_ptr;
+
+    unsigned nthreads;
+    int level;
+    std::string filling;
+    std::deque<block_ptr> queued; //in output order
+    std::deque<block_ptr> todo; //waiting for a worker
+    boost::mutex mutex;
+    boost::condition_variable work;
+    boost::condition_variable finished;
+    boost::thread_group workers;
+    bool stopping;
+
+    void compress_queued() {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      for (;;) {
+        while (todo.empty() && !stopping)
+          work.wait(lock);
+        if (todo.empty()) return;
+        block_ptr b = todo.front();
+        todo.pop_front();
+        lock.unlock();
+        compress_block(b->data, level);
+        lock.lock();
+        b->done = true;
+        finished.notify_all();
+      }
+    }
+
+  public:
+    bgzf_blocks(unsigned threads, int level_)
+        : nthreads(threads), level(level_), stopping(false) {
+      filling.reserve(block_size);
+    }
+
+    ~bgzf_blocks() {
+      {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        stopping = true;
+      }
+      work.notify_all();
+      workers.join_all();
+    }
+
+    std::streamsize add(const char* s, std::streamsize n) {
+      const std::streamsize room = block_size - filling.size();
+      if (n > room) n = room;
+      filling.append(s, n);
+      if (std::streamsize(filling.size()) == block_size) start();
+      return n;
+    }
+
+    //queue the block being filled for compression
+    void start() {
+      block_ptr b(new block);
+      b->data.swap(filling);
+      filling.reserve(block_size);
+      if (nthreads <= 1) {
+        compress_block(b->data, level);
+        b->done = true;
+        queued.push_back(b);
+        return;
+      }
+      if (workers.size() == 0)
+        for (unsigned i = 0; i < nthreads; i++)
+          workers.create_thread(
+              boost::bind(&bgzf_blocks::compress_queued, this));
+      boost::lock_guard<boost::mutex> lock(mutex);
+      queued.push_back(b);
+      todo.push_back(b);
+      work.notify_one();
+    }
+
+    void finish() {
+      if (filling.size() > 0) start();
+      block_ptr b(new block);
+      b->data.assign(eof_block, sizeof(eof_block));
+      b->done = true;
+      boost::lock_guard<boost::mutex> lock(mutex);
+      queued.push_back(b);
+    }
+
+    bool next(std::string& data, bool wait) {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      if (queued.empty()) return false;
+      block_ptr b = queued.front();
+      if (!b->done) {
+        //keep the memory in flight bounded if the workers fall behind
+        if (!wait && queued.size() <= queued_per_thread * nthreads)
+          return false;
+        while (!b->done)
+          finished.wait(lock);
+      }
+      queued.pop_front();
+      data.swap(b->data);
+      return true;
+    }
+};
+
+bgzf_compressor::bgzf_compressor(unsigned threads, int level)
+    : blocks(new bgzf_blocks(threads, level)) {
+}
+
+std::streamsize bgzf_compressor::add(const char* s, std::streamsize n) {
+  return blocks->add(s, n);
+}
+
+void bgzf_compressor::finish() {
+  blocks->finish();
+}
+
+bool bgzf_compressor::next(std::string& block, bool wait) {
+  return blocks->next(block, wait);
+}
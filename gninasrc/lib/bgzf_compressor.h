@@ -0,0 +1,71 @@
+/*
+ * bgzf_compressor.h
+ *
+ * Output filter that writes BGZF, the blocked gzip of samtools/tabix: the
+ * data is cut into blocks of under 64KB that are compressed as independent
+ * gzip members, each recording its compressed size in an extra header field.
+ * The result is still an ordinary .gz file, but blocks can be compressed on
+ * worker threads and readers can seek to any block.  Blocks are written in
+ * order on the thread that writes to the stream.
+ */
+
+#ifndef BGZF_COMPRESSOR_H_
+#define BGZF_COMPRESSOR_H_
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/iostreams/categories.hpp>
+#include <boost/iostreams/write.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+
+class bgzf_blocks;
+
+class bgzf_compressor {
+  public:
+    typedef char char_type;
+    struct category : boost::iostreams::multichar_output_filter_tag,
+        boost::iostreams::closable_tag {
+    };
+
+    //with threads > 1, blocks are compressed on that many worker threads,
+    //otherwise as they fill
+    explicit bgzf_compressor(unsigned threads = 1, int level =
+        boost::iostreams::zlib::default_compression);
+
+    template<typename Sink>
+    std::streamsize write(Sink& snk, const char* s, std::streamsize n) {
+      std::streamsize done = 0;
+      while (done < n) {
+        done += add(s + done, n - done);
+        write_ready(snk, false);
+      }
+      return n;
+    }
+
+    template<typename Sink>
+    void close(Sink& snk) {
+      finish();
+      write_ready(snk, true);
+    }
+
+  private:
+    boost::shared_ptr<bgzf_blocks> blocks; //shared by copies of the filter
+
+    //buffer up to n bytes of s, starting a block when one fills; return
+    //the number buffered
+    std::streamsize add(const char* s, std::streamsize n);
+    //start the last, partial block and queue the empty end of file block
+    void finish();
+    //next compressed block in order, if ready; with wait, or when too many
+    //blocks are queued, wait for it
+    bool next(std::string& block, bool wait);
+
+    template<typename Sink>
+    void write_ready(Sink& snk, bool wait) {
+      std::string block;
+      while (next(block, wait))
+        boost::iostreams::write(snk, block.data(), block.size());
+    }
+};
+
+#endif /* BGZF_COMPRESSOR_H_ */
@@ -0,0 +1,103 @@
+/*
+ * brick_array.h
+ *
+ * 3D array stored as 4x4x4 bricks with all channels of a voxel next to each
+ * other.  The 8 corners read by trilinear interpolation, for every channel,
+ * then usually fall in one or two cache lines instead of being spread over
+ * rows and planes of the whole array and a separate array per channel.
+ */
+
+#ifndef BRICK_ARRAY_H_
+#define BRICK_ARRAY_H_
+
+#include <vector>
+#include "array3d.h"
+
+template<typename T>
+class brick_array {
+    sz m_i, m_j, m_k; //dimensions in voxels
+    sz m_bi, m_bj, m_bk; //dimensions in bricks
+    sz m_channels;
+    std::vector<T> m_data;
+
+    friend class boost::serialization::access;
+    template<typename Archive>
+    void serialize(Archive& ar, const unsigned version) {
+      ar & m_i;
+      ar & m_j;
+      ar & m_k;
+      ar & m_bi;
+      ar & m_bj;
+      ar & m_bk;
+      ar & m_channels;
+      ar & m_data;
+    }
+
+  public:
+    static const sz brick_bits = 2; //bricks are 1 << brick_bits on a side
+    static const sz brick_side = 1 << brick_bits;
+    static const sz brick_mask = brick_side - 1;
+    static const sz brick_voxels = brick_side * brick_side * brick_side;
+
+    brick_array()
+        : m_i(0), m_j(0), m_k(0), m_bi(0), m_bj(0), m_bk(0), m_channels(0) {
+    }
+
+    void resize(sz i, sz j, sz k, sz channels) { // data is essentially garbled
+      m_i = i;
+      m_j = j;
+      m_k = k;
+      m_bi = (i + brick_mask) >> brick_bits;
+      m_bj = (j + brick_mask) >> brick_bits;
+      m_bk = (k + brick_mask) >> brick_bits;
+      m_channels = channels;
+      m_data.resize(
+          checked_multiply(checked_multiply(m_bi, m_bj, m_bk),
+              brick_voxels * channels));
+    }
+
+    sz dim0() const {
+      return m_i;
+    }
+    sz dim1() const {
+      return m_j;
+    }
+    sz dim2() const {
+      return m_k;
+    }
+    sz dim(sz i) const {
+      switch (i) {
+      case 0:
+        return m_i;
+      case 1:
+        return m_j;
+      case 2:
+        return m_k;
+      default:
+        assert(false);
+        return 0;
+      }
+    }
+    sz channels() const {
+      return m_channels;
+    }
+
+    //position of channel 0 of voxel i,j,k
+    sz offset(sz i, sz j, sz k) const {
+      const sz brick = (i >> brick_bits)
+          + m_bi * ((j >> brick_bits) + m_bj * (k >> brick_bits));
+      const sz voxel = (i & brick_mask)
+          + ((j & brick_mask) << brick_bits)
+          + ((k & brick_mask) << (2 * brick_bits));
+      return (brick * brick_voxels + voxel) * m_channels;
+    }
+
+    T& operator()(sz i, sz j, sz k, sz c) {
+      return m_data[offset(i, j, k) + c];
+    }
+    const T& operator()(sz i, sz j, sz k, sz c) const {
+      return m_data[offset(i, j, k) + c];
+    }
+};
+
+#endif /* BRICK_ARRAY_H_ */
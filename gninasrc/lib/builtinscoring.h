@@ -10,6 +10,7 @@
 #include <vector>
 #include <boost/unordered_map.hpp>
 #include "custom_terms.h"
+#include "fused_scoring.h"
 
 class builtin_scoring {
     struct singleterm {
@@ -35,6 +36,12 @@ class builtin_scoring {
       functions[name].push_back(singleterm(term, w));
     }
 
+    template<unsigned N>
+    void add(const std::string& name, const builtin_term (&terms)[N]) {
+      for (unsigned i = 0; i < N; i++)
+        add(name, terms[i].term, terms[i].weight);
+    }
+
     void addparams(const std::string& name, const smina_atom_type::info* data)
     {
       atomdata[name] = data;
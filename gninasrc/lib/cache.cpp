@@ -39,13 +39,14 @@ typedef boost::archive::text_oarchive oarchive;
 #include "szv_grid.h"
 
 cache::cache(const std::string& scoring_function_version_, const grid_dims& gd_,
-    fl slope_)
+    fl slope_, const grid_storage& storage_)
     : scoring_function_version(scoring_function_version_), gd(gd_),
-        slope(slope_), grids(num_atom_types()) {
+        slope(slope_), storage(storage_), grids(num_atom_types()) {
 }
 
 fl cache::eval(const model& m, fl v) const { // needs m.coords
   fl e = 0;
+  lazy_grid::reader reading(lazy.get());
   sz nat = num_atom_types();
 
   VINA_FOR(i, m.num_movable_atoms()) {
@@ -61,6 +62,7 @@ fl cache::eval(const model& m, fl v) const { // needs m.coords
 
 fl cache::eval_deriv(model& m, fl v, const grid& user_grid) const { // needs m.coords, sets m.minus_forces
   fl e = 0;
+  lazy_grid::reader reading(lazy.get());
   sz nat = num_atom_types();
 
   VINA_FOR(i, m.num_movable_atoms()) {
@@ -108,10 +110,20 @@ void cache::populate(const model& m, const precalculate& p,
     smt t = atom_types_needed[i];
     if (!grids[t].initialized()) {
       needed.push_back(t);
-      grids[t].init(gd, haschargeterms);
+      if (!storage.lazy) grids[t].init(gd, haschargeterms, storage);
     }
   }
   if (needed.empty()) return;
+  if (storage.lazy) {
+    //one set of tiles covers every type, so start over with all of them
+    VINA_FOR_IN(t, grids)
+      if (grids[t].initialized()) needed.push_back(smt(t));
+    lazy.reset(
+        new lazy_grid(gd, m.grid_atoms, p, needed, storage.lazy_max_bytes));
+    VINA_FOR_IN(i, needed)
+      grids[needed[i]].init(gd, lazy, needed[i]);
+    return;
+  }
   flv affinities(needed.size());
   flv chargeaffinities;
   if (haschargeterms) chargeaffinities.resize(needed.size());
@@ -125,9 +137,9 @@ void cache::populate(const model& m, const precalculate& p,
   szv_grid_cache igcache(m, cutoff_sqr);
   szv_grid ig(igcache, gd);
 
-  VINA_FOR(x, g.data.dim0()) {
-    VINA_FOR(y, g.data.dim1()) {
-      VINA_FOR(z, g.data.dim2()) {
+  VINA_FOR(x, gd[0].n + 1) {
+    VINA_FOR(y, gd[1].n + 1) {
+      VINA_FOR(z, gd[2].n + 1) {
         std::fill(affinities.begin(), affinities.end(), 0);
         std::fill(chargeaffinities.begin(), chargeaffinities.end(), 0);
         vec probe_coords;
@@ -136,42 +148,19 @@ void cache::populate(const model& m, const precalculate& p,
         VINA_FOR_IN(possibilities_i, possibilities) {
           const sz i = possibilities[possibilities_i];
           const atom& a = m.grid_atoms[i];
-          const smt t1 = a.get();
           const fl r2 = vec_distance_sqr(a.coords, probe_coords);
-          if (r2 <= cutoff_sqr) {
-            VINA_FOR_IN(j, needed) {
-              const smt t2 = needed[j];
-              assert(t2 < nat);
-              //t1 is the receptor atom, a
-              //t2 is type from the ligand, not corresponding to any
-              //particular atom
-              result_components val = p.eval_fast(t1, t2, r2);
-              if (haschargeterms) {
-                //affinities contains the terms that are independent of
-                //the ligand atom charge
-
-                affinities[j] += val[result_components::TypeDependentOnly]
-                    + val[result_components::AbsAChargeDependent]
-                        * fabs(a.charge);
-                //this component must be multiplied by the ligand atom charge
-                chargeaffinities[j] +=
-                    val[result_components::AbsBChargeDependent]
-                        + val[result_components::ABChargeDependent] * a.charge; //not abs value
-              } else {
-                affinities[j] += val[result_components::TypeDependentOnly];
-              }
-            }
-          }
+          if (r2 <= cutoff_sqr)
+            add_affinities(p, a, r2, needed, haschargeterms, affinities,
+                chargeaffinities);
         }
         VINA_FOR_IN(j, needed) {
           sz t = needed[j];
           assert(t < nat);
-          grids[t].data(x, y, z) = affinities[j]; //+ user_grid.evaluate_user(vec(x, y, z));
-          if (haschargeterms) grids[t].chargedata(x, y, z) =
-              chargeaffinities[j];
+          fl value = affinities[j];
           if (user_grid.initialized())
-            grids[t].data(x, y, z) += user_grid.evaluate_user(vec(x, y, z),
-                slope);
+            value += user_grid.evaluate_user(vec(x, y, z), slope);
+          grids[t].set(x, y, z, value);
+          if (haschargeterms) grids[t].set_charge(x, y, z, chargeaffinities[j]);
         }
       }
     }
@@ -40,13 +40,17 @@ struct energy_mismatch : public cache_mismatch {
 
 struct cache : public igrid {
     cache(const std::string& scoring_function_version_, const grid_dims& gd_,
-        fl slope_);
+        fl slope_, const grid_storage& storage_ = grid_storage());
     fl eval(const model& m, fl v) const; // needs m.coords // clean up
     fl eval_deriv(model& m, fl v, const grid& user_grid) const; // needs m.coords, sets m.minus_forces // clean up
 
     virtual void populate(const model& m, const precalculate& p,
         const std::vector<smt>& atom_types_needed, grid& user_grid,
         bool display_progress = true);
+    //the tiles behind the grids if storage.lazy, null otherwise
+    const lazy_grid* lazy_tiles() const {
+      return lazy.get();
+    }
     virtual ~cache() {
     }
     ;
@@ -55,7 +59,9 @@ struct cache : public igrid {
     atomv atoms; // for verification
     grid_dims gd;
     fl slope; // does not get (de-)serialized
+    grid_storage storage; // does not get (de-)serialized
     std::vector<grid> grids;
+    boost::shared_ptr<lazy_grid> lazy; //tiles of all grids if storage.lazy
     friend class boost::serialization::access;
     friend class cache_gpu;
     template<class Archive>
@@ -11,6 +11,7 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/layers/pooling_layer.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/fuse_relu.hpp"
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/text_format.h>
@@ -44,6 +45,27 @@ CNNScorer::CNNScorer(const cnn_options& opts)
     }
 
     param.mutable_state()->set_phase(TEST);
+    //compute relus as part of the preceding convolution
+    FuseConvolutionReLU(&param);
+    //the first convolution sees (pooled) atom density grids, which are mostly
+    //empty, so let it skip over zeros
+    for (int i = 0, n = param.layer_size(); i < n; i++) {
+      if (param.layer(i).type() == "Convolution") {
+        param.mutable_layer(i)->mutable_convolution_param()->set_sparse_input(true);
+        break;
+      }
+    }
+
+    if (cnnopts.cnn_precision == "int8") {
+      for (int i = 0, n = param.layer_size(); i < n; i++) {
+        if (param.layer(i).type() == "Convolution") {
+          param.mutable_layer(i)->mutable_convolution_param()->set_precision(
+              ConvolutionParameter_Precision_INT8);
+        }
+      }
+    } else if (cnnopts.cnn_precision != "fp32") {
+      throw usage_error("Invalid cnn precision: "+cnnopts.cnn_precision);
+    }
 
     LayerParameter *first = param.mutable_layer(0);
     mgridparam = first->mutable_molgrid_data_param();
@@ -455,6 +477,9 @@ float CNNScorer::score(model& m, bool compute_gradient, float& affinity,
   if (!initialized()) return -1.0;
 
   caffe::Caffe::set_random_seed(cnnopts.seed); //same random rotations for each ligand..
+  //caffe's settings are per thread and scoring is serialized, so whichever
+  //thread scores gets the cores set aside for it
+  caffe::Caffe::set_cpu_threads(cnnopts.cpu_threads);
 
   if (!isnan(cnnopts.cnn_center[0])) {
     mgrid->setGridCenter(cnnopts.cnn_center);
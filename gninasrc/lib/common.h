@@ -35,7 +35,8 @@ typedef float fl;
 //collection of parameters specifying how minimization should be done
 struct minimization_params {
     enum Type {
-      BFGSFastLineSearch, BFGSAccurateLineSearch, ConjugateGradient, Simple
+      BFGSFastLineSearch, BFGSAccurateLineSearch, ConjugateGradient, Simple,
+      LBFGSFastLineSearch, LBFGSAccurateLineSearch
     };
 
     Type type;
@@ -43,9 +44,10 @@ struct minimization_params {
     bool early_term; //terminate early based on different of function values
     bool single_min; //do single full minimization instead of hunt_cap truncated followed by full
     int outputframes;
+    unsigned history; //number of updates remembered by L-BFGS
     minimization_params()
         : type(BFGSFastLineSearch), maxiters(0), early_term(false),
-            single_min(false), outputframes(0) {
+            single_min(false), outputframes(0), history(10) {
 
     }
 };
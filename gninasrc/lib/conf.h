@@ -520,8 +520,9 @@ struct output_type {
     conf c;
     fl e;
     vecv coords;
+    sz conformer; //which rigid conformer c places, see parallel_mc
     output_type(const conf& c_, fl e_)
-        : c(c_), e(e_) {
+        : c(c_), e(e_), conformer(0) {
     }
 };
 
@@ -30,6 +30,8 @@
 #include <boost/iostreams/stream.hpp>
 #include <boost/iostreams/device/null.hpp>
 #include "common.h"
+#include "bgzf_compressor.h"
+#include "readahead_source.h"
 
 struct file_error {
     path name;
@@ -62,10 +64,9 @@ struct ofile : public boost::filesystem::ofstream { // never use ofstream pointe
 };
 
 //dkoes - wrapper for an input file that is optionally gzipped
-//name ends in .gz
+//name ends in .gz; the file is read and decompressed ahead on another thread
 class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input> {
 
-    std::ifstream uncompressed_infile;
     bool iszipped;
   public:
 
@@ -86,7 +87,6 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
       //clean up if we are already open
       while (!empty())
         pop();
-      uncompressed_infile.close();
 
       std::string fileext = extension(name);
       if (fileext == ".gz") {
@@ -96,14 +96,10 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
 
       if (fileext != ext) return false; //wrong type of file
 
-      uncompressed_infile.open(name.c_str());
+      readahead_source infile(name.string(), iszipped);
+      push(infile);
 
-      if (iszipped) {
-        push(boost::iostreams::gzip_decompressor());
-      }
-      push(uncompressed_infile);
-
-      if (!uncompressed_infile || !*this) {
+      if (!infile.is_open() || !*this) {
         throw file_error(path(name), true);
       }
 
@@ -118,7 +114,8 @@ class izfile : public boost::iostreams::filtering_stream<boost::iostreams::input
 };
 
 //dkoes - wrapper for an output file that will be gzipped if the file
-//name ends in .gz
+//name ends in .gz; gzipped output is blocked (BGZF) so it can be compressed
+//on several threads
 class ozfile : public boost::iostreams::filtering_stream<
     boost::iostreams::output> {
 
@@ -128,13 +125,14 @@ class ozfile : public boost::iostreams::filtering_stream<
     ozfile() {
     }
 
-    ozfile(const path& name) {
-      open(name);
+    ozfile(const path& name, unsigned threads = 1) {
+      open(name, threads);
     }
 
-    //opens file name, with gzip filter if name ends with .gz
+    //opens file name, with gzip filter if name ends with .gz, compressing
+    //on threads threads
     //return non-gz extension
-    std::string open(const path& name) {
+    std::string open(const path& name, unsigned threads = 1) {
       using namespace boost::filesystem;
       uncompressed_outfile.open(name.c_str());
       if (!uncompressed_outfile) throw file_error(name, false);
@@ -143,7 +141,7 @@ class ozfile : public boost::iostreams::filtering_stream<
       //should we gzip?
       if (ext == ".gz") {
         ext = extension(basename(name));
-        push(boost::iostreams::gzip_compressor());
+        push(bgzf_compressor(threads));
       }
       push(uncompressed_outfile);
       if (!(*this)) throw file_error(name, false);
@@ -0,0 +1,130 @@
+/*
+ * flat_tree.cpp
+ *
+ * The arithmetic here deliberately mirrors tree.h operation for operation
+ * so that coordinates and gradients are bitwise identical.
+ */
+
+#include "flat_tree.h"
+
+void flat_tree::add_ligand(const flexible_body& lig) {
+  assert(num_residues == 0);
+  unsigned t = num_ligands++;
+  roots.push_back(nodes.size());
+  nodes.push_back(flat_node(lig.node, lig.node, -1, t, -1));
+  int torsion = 0;
+  add_children(nodes.size() - 1, lig.children, t, torsion);
+  force_torques.resize(nodes.size());
+  residues_begin = nodes.size();
+}
+
+void flat_tree::add_residue(const main_branch& res) {
+  unsigned t = num_ligands + num_residues++;
+  roots.push_back(nodes.size());
+  nodes.push_back(flat_node(res.node, res.node, -1, t, 0));
+  nodes.back().axis = res.node.axis;
+  int torsion = 1;
+  add_children(nodes.size() - 1, res.children, t, torsion);
+  force_torques.resize(nodes.size());
+}
+
+//children are added depth first after their parent, their indices are
+//recorded contiguously in child_index once all of them are placed
+void flat_tree::add_children(unsigned n, const branches& children,
+    unsigned tree, int& torsion) {
+  std::vector<unsigned> mine;
+  VINA_FOR_IN(i, children)
+    mine.push_back(add_branch(children[i], n, tree, torsion));
+  nodes[n].children_begin = child_index.size();
+  child_index.insert(child_index.end(), mine.begin(), mine.end());
+  nodes[n].children_end = child_index.size();
+}
+
+unsigned flat_tree::add_branch(const branch& b, int parent, unsigned tree,
+    int& torsion) {
+  unsigned n = nodes.size();
+  nodes.push_back(flat_node(b.node, b.node, parent, tree, torsion++));
+  nodes[n].relative_origin = b.node.relative_origin;
+  nodes[n].relative_axis = b.node.relative_axis;
+  nodes[n].axis = b.node.axis;
+  add_children(n, b.children, tree, torsion);
+  return n;
+}
+
+fl flat_tree::torsion(const conf& c, const flat_node& n) const {
+  if (n.tree < num_ligands) return c.ligands[n.tree].torsions[n.torsion];
+  return c.flex[n.tree - num_ligands].torsions[n.torsion];
+}
+
+void flat_tree::store_branch_frames(branches& children, unsigned& n) const {
+  VINA_FOR_IN(i, children) {
+    segment& s = children[i].node;
+    static_cast<frame&>(s) = nodes[n];
+    s.axis = nodes[n].axis;
+    n++;
+    store_branch_frames(children[i].children, n);
+  }
+}
+
+void flat_tree::set_conf(const atomv& atoms, vecv& coords, const conf& c) {
+  set_nodes(0, atoms, coords, c);
+}
+
+void flat_tree::set_flex_conf(const atomv& atoms, vecv& coords,
+    const conf& c) {
+  set_nodes(residues_begin, atoms, coords, c);
+}
+
+void flat_tree::set_nodes(sz begin, const atomv& atoms, vecv& coords,
+    const conf& c) {
+  VINA_RANGE(i, begin, nodes.size()) {
+    flat_node& n = nodes[i];
+    if (n.parent >= 0) { //segment
+      const flat_node& p = nodes[n.parent];
+      n.axis = p.local_to_lab_direction(n.relative_axis);
+      n.set_frame(p.local_to_lab(n.relative_origin),
+          quaternion_normalize_approx(
+              angle_to_quaternion(n.axis, torsion(c, n)) * p.orientation()));
+    } else if (n.tree < num_ligands) { //rigid_body
+      const rigid_conf& rc = c.ligands[n.tree].rigid;
+      n.set_frame(rc.position, rc.orientation);
+    } else { //first_segment
+      n.set_frame(n.get_origin(), angle_to_quaternion(n.axis, torsion(c, n)));
+    }
+    VINA_RANGE(j, n.begin, n.end)
+      coords[j] = n.local_to_lab(atoms[j].coords);
+  }
+}
+
+void flat_tree::derivative(const vecv& coords, const vecv& forces,
+    change& g) {
+  //children always follow their parent, so a reverse sweep sees them first
+  for (sz i = nodes.size(); i-- > 0;) {
+    const flat_node& n = nodes[i];
+    const vec& origin = n.get_origin();
+    vecp& ft = force_torques[i];
+    ft.first = vec(0, 0, 0);
+    ft.second = vec(0, 0, 0);
+    VINA_RANGE(j, n.begin, n.end) {
+      ft.first += forces[j];
+      ft.second += cross_product(coords[j] - origin, forces[j]);
+    }
+    VINA_RANGE(k, n.children_begin, n.children_end) {
+      unsigned ch = child_index[k];
+      const vecp& cft = force_torques[ch];
+      ft.first += cft.first;
+      vec r;
+      r = nodes[ch].get_origin() - origin;
+      ft.second += cross_product(r, cft.first) + cft.second;
+    }
+
+    if (n.tree >= num_ligands)
+      g.flex[n.tree - num_ligands].torsions[n.torsion] = ft.second * n.axis;
+    else if (n.parent >= 0)
+      g.ligands[n.tree].torsions[n.torsion] = ft.second * n.axis;
+    else {
+      g.ligands[n.tree].rigid.position = ft.first;
+      g.ligands[n.tree].rigid.orientation = ft.second;
+    }
+  }
+}
@@ -0,0 +1,115 @@
+/*
+ * flat_tree.h
+ *
+ * Flattened CPU form of the ligand and flexible residue torsion trees.  The
+ * nodes of every tree are stored in one contiguous array in depth first
+ * order, the same order torsions are stored in a conf, so setting a
+ * conformation is a single forward sweep and computing derivatives a single
+ * backward sweep with no recursion or allocation.  Results are identical to
+ * the recursive heterotree/tree code in tree.h, which is still used to build
+ * and edit the model.  Only the flat nodes are kept current; store_frames
+ * copies their frames back into those trees before the trees themselves are
+ * read or copied.
+ */
+
+#ifndef FLAT_TREE_H_
+#define FLAT_TREE_H_
+
+#include <vector>
+#include "tree.h"
+
+struct flat_node : public frame {
+    vec relative_origin; //segments only, relative to the parent frame
+    vec relative_axis;
+    vec axis; //torsion axis, unused for ligand roots
+    sz begin; //atoms
+    sz end;
+    int parent; //index of parent node, -1 for a root
+    unsigned children_begin; //range of children in flat_tree::child_index
+    unsigned children_end;
+    unsigned tree; //ligand index, or number of ligands + residue index
+    int torsion; //index into the tree's torsions, -1 for a ligand root
+
+    flat_node(const frame& f, const atom_range& r, int parent_, unsigned tree_,
+        int torsion_)
+        : frame(f), relative_origin(0, 0, 0), relative_axis(0, 0, 0),
+            axis(0, 0, 0), begin(r.begin), end(r.end), parent(parent_),
+            children_begin(0), children_end(0), tree(tree_),
+            torsion(torsion_) {
+    }
+
+    void set_frame(const vec& origin_, const qt& q) {
+      origin = origin_;
+      set_orientation(q);
+    }
+};
+
+class flat_tree {
+    std::vector<flat_node> nodes;
+    std::vector<unsigned> child_index;
+    std::vector<unsigned> roots; //index of the root node of each tree
+    std::vector<vecp> force_torques; //scratch for derivative, one per node
+    unsigned num_ligands;
+    unsigned num_residues;
+    unsigned residues_begin; //index of the first residue node
+
+    unsigned add_branch(const branch& b, int parent, unsigned tree,
+        int& torsion);
+    void add_children(unsigned n, const branches& children, unsigned tree,
+        int& torsion);
+    fl torsion(const conf& c, const flat_node& n) const;
+    void set_nodes(sz begin, const atomv& atoms, vecv& coords, const conf& c);
+
+    template<typename Node>
+    void store_tree_frames(heterotree<Node>& t, unsigned& n) const {
+      static_cast<frame&>(t.node) = nodes[n++];
+      store_branch_frames(t.children, n);
+    }
+    void store_branch_frames(branches& children, unsigned& n) const;
+
+  public:
+    flat_tree()
+        : num_ligands(0), num_residues(0), residues_begin(0) {
+    }
+
+    //all ligands must be added before any residue, in model order
+    void add_ligand(const flexible_body& lig);
+    void add_residue(const main_branch& res);
+
+    sz num_trees() const {
+      return num_ligands + num_residues;
+    }
+
+    //origin of the root frame of a tree as of the last set_conf
+    const vec& origin(sz tree) const {
+      return nodes[roots[tree]].get_origin();
+    }
+
+    //same as ligands.set_conf and flex.set_conf on the trees
+    void set_conf(const atomv& atoms, vecv& coords, const conf& c);
+
+    //same as flex.set_conf on the trees, ligands are left alone
+    void set_flex_conf(const atomv& atoms, vecv& coords, const conf& c);
+
+    //copy every node frame (and segment axis) set by set_conf into the
+    //trees this was built from, which must be unchanged since; they may be
+    //the last ones of ligands and flex, starting at first_ligand and
+    //first_residue
+    template<typename Ligands, typename Residues>
+    void store_frames(Ligands& ligands, Residues& flex, sz first_ligand = 0,
+        sz first_residue = 0) const {
+      assert(ligands.size() == first_ligand + num_ligands);
+      assert(flex.size() == first_residue + num_residues);
+      unsigned n = 0;
+      VINA_FOR(i, num_ligands)
+        store_tree_frames(ligands[first_ligand + i], n);
+      VINA_FOR(i, num_residues)
+        store_tree_frames(flex[first_residue + i], n);
+      assert(n == nodes.size());
+    }
+
+    //same as ligands.derivative and flex.derivative on the trees
+    void derivative(const vecv& coords, const vecv& forces, change& g);
+};
+
+#endif /* FLAT_TREE_H_ */
@@ -410,4 +410,35 @@ void FlexInfo::printFlex() const{
     }
     log << "\n";
   }
-}
\ No newline at end of file
+}
+std::vector<std::tuple<char, int, char> > FlexInfo::getResidues() const {
+  std::vector<std::tuple<char, int, char> > sortedres(residues.begin(), residues.end());
+  sort(sortedres.begin(), sortedres.end());
+  return sortedres;
+}
+
+void FlexInfo::setResidues(const std::vector<std::tuple<char, int, char> >& res) {
+  residues.clear();
+  residues.insert(res.begin(), res.end());
+}
+
+std::string FlexInfo::cacheKey() const {
+  if (!hasContent()) return "rigid";
+
+  std::stringstream ss;
+  ss << flex_dist << " " << nflex << " " << nflex_hard_limit << " " << defaultch;
+  std::vector<std::tuple<char, int, char> > sortedres(residues.begin(), residues.end());
+  sort(sortedres.begin(), sortedres.end());
+  for (unsigned i = 0, n = sortedres.size(); i < n; i++) {
+    ss << " " << int(get<0>(sortedres[i])) << ":" << get<1>(sortedres[i]) << ":"
+        << int(get<2>(sortedres[i]));
+  }
+  if (flex_dist > 0) {
+    //residues near the distance ligand are flexible, so its coordinates matter
+    OpenBabel::OBMol& lig = const_cast<OpenBabel::OBMol&>(distligand);
+    FOR_ATOMS_OF_MOL(a, lig) {
+      ss << " " << a->GetX() << "," << a->GetY() << "," << a->GetZ();
+    }
+  }
+  return ss.str();
+}
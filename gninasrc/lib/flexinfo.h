@@ -40,6 +40,15 @@ class FlexInfo {
 
     void printFlex() const;
 
+    //description of every setting that determines the flexible residues
+    std::string cacheKey() const;
+
+    //flexible residues (chain, resid, insertion code) in sorted order, as
+    //picked by extractFlex; setResidues restores them for a receptor that
+    //was prepared by an earlier run
+    std::vector<std::tuple<char, int, char> > getResidues() const;
+    void setResidues(const std::vector<std::tuple<char, int, char> >& res);
+
   private:
     void sanitizeResidues(OpenBabel::OBMol& receptor); //remove inflexible residues from residues set
     void keepNearestResidues(
@@ -0,0 +1,67 @@
+/*
+ * fp16.h
+ *
+ * Conversion between float and IEEE half precision, stored as uint16_t.
+ * Used for compact grid storage, so conversion to float needs to be cheap;
+ * conversion from float only happens while grids are filled.
+ */
+
+#ifndef FP16_H_
+#define FP16_H_
+
+#include <stdint.h>
+#include <cstring>
+
+//largest finite half
+#define FP16_MAX 65504.0f
+
+inline float half_to_float(uint16_t h) {
+  const uint32_t shifted_exp = 0x7c00u << 13; //exponent mask after shift
+  uint32_t bits = (h & 0x7fffu) << 13; //exponent and mantissa
+  const uint32_t exp = shifted_exp & bits;
+  bits += (127 - 15) << 23; //rebias exponent
+  float f;
+  if (exp == shifted_exp) { //inf or nan
+    bits += (128 - 16) << 23;
+    std::memcpy(&f, &bits, sizeof(f));
+  } else
+    if (exp == 0) { //zero or subnormal, renormalize through the fpu
+      bits += 1 << 23;
+      std::memcpy(&f, &bits, sizeof(f));
+      const uint32_t magic_bits = 113u << 23;
+      float magic;
+      std::memcpy(&magic, &magic_bits, sizeof(magic));
+      f -= magic;
+    } else
+      std::memcpy(&f, &bits, sizeof(f));
+  return (h & 0x8000u) ? -f : f;
+}
+
+//round to nearest even, values too large for a half saturate at +-FP16_MAX
+//rather than becoming infinite so that interpolation stays finite
+inline uint16_t float_to_half(float f) {
+  if (f > FP16_MAX) f = FP16_MAX;
+  if (f < -FP16_MAX) f = -FP16_MAX;
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  const uint16_t sign = (bits >> 16) & 0x8000u;
+  bits &= 0x7fffffffu;
+
+  if (bits > 0x7f800000u) return sign | 0x7e00u; //nan
+  if (bits < (113u << 23)) { //subnormal or zero in half precision
+    //add 0.5 in the half's smallest subnormal units, the fpu does the rounding
+    float a, magic;
+    const uint32_t magic_bits = 126u << 23;
+    std::memcpy(&a, &bits, sizeof(a));
+    std::memcpy(&magic, &magic_bits, sizeof(magic));
+    a += magic;
+    std::memcpy(&bits, &a, sizeof(bits));
+    return sign | uint16_t(bits - magic_bits);
+  }
+  const uint32_t mant_odd = (bits >> 13) & 1;
+  bits += ((15u - 127u) << 23) + 0xfffu; //rebias and round
+  bits += mant_odd;
+  return sign | uint16_t(bits >> 13);
+}
+
+#endif /* FP16_H_ */
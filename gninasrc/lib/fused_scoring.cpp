@@ -0,0 +1,58 @@
+/*
+ * fused_scoring.cpp
+ *
+ * Choosing a fused evaluator for the scoring function in effect.
+ */
+
+#include "fused_scoring.h"
+
+//does sf give exactly the same values as plain weighted terms for every pair
+//of atom types over the whole cutoff; this catches any change to the terms,
+//weights or atom parameters from the built-in function, and a compiler that
+//contracts the fused sums differently
+static bool agrees(const weighted_terms& sf, const weighted_terms& plain) {
+  if (sf.cutoff() != plain.cutoff()
+      || sf.num_used_components() != plain.num_used_components())
+    return false;
+  const fl step = 0.1;
+  VINA_FOR(t1, smina_atom_type::NumTypes) {
+    VINA_FOR(t2, smina_atom_type::NumTypes) {
+      for (fl r = 0; r <= plain.cutoff(); r += step) {
+        result_components a = sf.eval_fast(smt(t1), smt(t2), r);
+        result_components b = plain.eval_fast(smt(t1), smt(t2), r);
+        VINA_FOR(c, result_components::Last) {
+          if (a[c] != b[c]) return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+template<typename Fused>
+static weighted_terms* try_fused(const terms* t, const flv& weights) {
+  std::unique_ptr<weighted_terms> fused(new fused_terms<Fused>(t, weights));
+  weighted_terms plain(t, weights);
+  if (agrees(*fused, plain)) return fused.release();
+  return NULL;
+}
+
+weighted_terms* new_weighted_terms(const terms* t, const flv& weights,
+    const std::string& builtin) {
+  weighted_terms* ret = NULL;
+  if (t->distance_additive_terms.num_enabled() == 0) {
+    if (builtin == "vina" || builtin == "default")
+      ret = try_fused<vina_fused>(t, weights);
+    else
+      if (builtin == "vinardo")
+        ret = try_fused<vinardo_fused>(t, weights);
+      else
+        if (builtin == "dkoes_scoring")
+          ret = try_fused<dkoes_scoring_fused>(t, weights);
+        else
+          if (builtin == "ad4_scoring")
+            ret = try_fused<ad4_scoring_fused>(t, weights);
+  }
+  if (!ret) ret = new weighted_terms(t, weights);
+  return ret;
+}
@@ -0,0 +1,197 @@
+/*
+ * fused_scoring.h
+ *
+ * Fused evaluators for the built-in scoring functions.  The generic
+ * weighted_terms loops over term lists with a virtual call per term; a fused
+ * evaluator knows the concrete terms of its function and their weights at
+ * compile time, so every term is inlined into one function that fills in a
+ * single result_components.  They are used when the terms in effect are
+ * exactly a built-in function; --custom_scoring still uses weighted_terms.
+ */
+
+#ifndef FUSED_SCORING_H_
+#define FUSED_SCORING_H_
+
+#include <memory>
+#include <string>
+#include "weighted_terms.h"
+#include "everything.h"
+
+//a term of a built-in scoring function and its weight
+struct builtin_term {
+    const char* term;
+    double weight;
+};
+
+//terms of the built-in functions with fused evaluators, in the order
+//weighted_terms uses them: charge independent, charge dependent, then
+//conf independent
+namespace builtin_terms {
+constexpr builtin_term vina[] = {
+    { "gauss(o=0,_w=0.5,_c=8)", -0.035579 },
+    { "gauss(o=3,_w=2,_c=8)", -0.005156 },
+    { "repulsion(o=0,_c=8)", 0.840245 },
+    { "hydrophobic(g=0.5,_b=1.5,_c=8)", -0.035069 },
+    { "non_dir_h_bond(g=-0.7,_b=0,_c=8)", -0.587439 },
+    { "num_tors_div", 5 * 0.05846 / 0.1 - 1 } };
+
+constexpr builtin_term vinardo[] = {
+    { "gauss(o=0,_w=0.8,_c=8)", -0.045 },
+    { "repulsion(o=0,_c=8)", 0.80 },
+    { "hydrophobic(g=0.0,_b=2.5,_c=8)", -0.035 },
+    { "non_dir_h_bond(g=-0.6,_b=0,_c=8)", -0.60 },
+    { "num_tors_div", 5 * 0.02 / 0.1 - 1 } };
+
+constexpr builtin_term dkoes_scoring[] = {
+    { "vdw(i=4,_j=8,_s=0,_^=100,_c=8)", 0.009900 },
+    { "non_dir_h_bond(g=-0.7,_b=0,_c=8)", -0.153055 },
+    { "ad4_solvation(d-sigma=3.6,_s/q=0.01097,_c=8)", 0.048934 },
+    { "num_tors_sqr", 0.317267 },
+    { "constant_term", -2.469020 } };
+
+constexpr builtin_term ad4_scoring[] = {
+    { "vdw(i=6,_j=12,_s=0,_^=100,_c=8)", 0.1560 },
+    { "non_dir_h_bond_lj(o=-0.7,_^=100,_c=8)", 0.0974 },
+    { "ad4_solvation(d-sigma=3.5,_s/q=0.01097,_c=8)", 0.1159 },
+    { "electrostatic(i=1,_^=100,_c=8)", 0.1465 },
+    { "num_tors_add", 0.2744 } };
+}
+
+//term of concrete type T built from its description, so its parameters
+//come from the same place as the generic function's
+template<typename T>
+T builtin_term_of(const builtin_term& b) {
+  std::unique_ptr<term> t(T().createFrom(b.term));
+  T* concrete = dynamic_cast<T*>(t.get());
+  VINA_CHECK(concrete);
+  return *concrete;
+}
+
+//calls are qualified with the term type so they are not virtual; terms are
+//summed in the same order as weighted_terms::eval_fast so that the results
+//are identical, not just close
+struct vina_fused {
+    gauss g1, g2;
+    repulsion rep;
+    hydrophobic hydro;
+    non_dir_h_bond hbond;
+    vina_fused()
+        : g1(builtin_term_of<gauss>(builtin_terms::vina[0])),
+            g2(builtin_term_of<gauss>(builtin_terms::vina[1])),
+            rep(builtin_term_of<repulsion>(builtin_terms::vina[2])),
+            hydro(builtin_term_of<hydrophobic>(builtin_terms::vina[3])),
+            hbond(builtin_term_of<non_dir_h_bond>(builtin_terms::vina[4])) {
+    }
+    result_components operator()(smt t1, smt t2, fl r) const {
+      using builtin_terms::vina;
+      result_components acc;
+      acc[result_components::TypeDependentOnly] = fl(vina[0].weight)
+          * g1.gauss::eval(t1, t2, r)
+          + fl(vina[1].weight) * g2.gauss::eval(t1, t2, r)
+          + fl(vina[2].weight) * rep.repulsion::eval(t1, t2, r)
+          + fl(vina[3].weight) * hydro.hydrophobic::eval(t1, t2, r)
+          + fl(vina[4].weight) * hbond.non_dir_h_bond::eval(t1, t2, r);
+      return acc;
+    }
+};
+
+struct vinardo_fused {
+    gauss g;
+    repulsion rep;
+    hydrophobic hydro;
+    non_dir_h_bond hbond;
+    vinardo_fused()
+        : g(builtin_term_of<gauss>(builtin_terms::vinardo[0])),
+            rep(builtin_term_of<repulsion>(builtin_terms::vinardo[1])),
+            hydro(builtin_term_of<hydrophobic>(builtin_terms::vinardo[2])),
+            hbond(builtin_term_of<non_dir_h_bond>(builtin_terms::vinardo[3])) {
+    }
+    result_components operator()(smt t1, smt t2, fl r) const {
+      using builtin_terms::vinardo;
+      result_components acc;
+      acc[result_components::TypeDependentOnly] = fl(vinardo[0].weight)
+          * g.gauss::eval(t1, t2, r)
+          + fl(vinardo[1].weight) * rep.repulsion::eval(t1, t2, r)
+          + fl(vinardo[2].weight) * hydro.hydrophobic::eval(t1, t2, r)
+          + fl(vinardo[3].weight) * hbond.non_dir_h_bond::eval(t1, t2, r);
+      return acc;
+    }
+};
+
+struct dkoes_scoring_fused {
+    vdw<4, 8> steric;
+    non_dir_h_bond hbond;
+    ad4_solvation solvation;
+    dkoes_scoring_fused()
+        : steric(builtin_term_of<vdw<4, 8> >(builtin_terms::dkoes_scoring[0])),
+            hbond(
+                builtin_term_of<non_dir_h_bond>(
+                    builtin_terms::dkoes_scoring[1])),
+            solvation(
+                builtin_term_of<ad4_solvation>(
+                    builtin_terms::dkoes_scoring[2])) {
+    }
+    result_components operator()(smt t1, smt t2, fl r) const {
+      using builtin_terms::dkoes_scoring;
+      result_components acc;
+      acc[result_components::TypeDependentOnly] = fl(dkoes_scoring[0].weight)
+          * steric.vdw<4, 8>::eval(t1, t2, r)
+          + fl(dkoes_scoring[1].weight) * hbond.non_dir_h_bond::eval(t1, t2, r);
+      acc += solvation.ad4_solvation::eval_components(t1, t2, r)
+          * fl(dkoes_scoring[2].weight);
+      return acc;
+    }
+};
+
+struct ad4_scoring_fused {
+    vdw<6, 12> steric;
+    non_dir_h_bond_lj hbond;
+    ad4_solvation solvation;
+    electrostatic<1> elec;
+    ad4_scoring_fused()
+        : steric(builtin_term_of<vdw<6, 12> >(builtin_terms::ad4_scoring[0])),
+            hbond(
+                builtin_term_of<non_dir_h_bond_lj>(
+                    builtin_terms::ad4_scoring[1])),
+            solvation(
+                builtin_term_of<ad4_solvation>(builtin_terms::ad4_scoring[2])),
+            elec(
+                builtin_term_of<electrostatic<1> >(
+                    builtin_terms::ad4_scoring[3])) {
+    }
+    result_components operator()(smt t1, smt t2, fl r) const {
+      using builtin_terms::ad4_scoring;
+      result_components acc;
+      acc[result_components::TypeDependentOnly] = fl(ad4_scoring[0].weight)
+          * steric.vdw<6, 12>::eval(t1, t2, r)
+          + fl(ad4_scoring[1].weight)
+              * hbond.non_dir_h_bond_lj::eval(t1, t2, r);
+      acc += solvation.ad4_solvation::eval_components(t1, t2, r)
+          * fl(ad4_scoring[2].weight);
+      acc += elec.electrostatic<1>::eval_components(t1, t2, r)
+          * fl(ad4_scoring[3].weight);
+      return acc;
+    }
+};
+
+//weighted_terms whose atom type dependent part is evaluated by Fused; the
+//conf independent terms are still those of t
+template<typename Fused>
+class fused_terms : public weighted_terms {
+    Fused fused;
+  public:
+    fused_terms(const terms* t, const flv& weights)
+        : weighted_terms(t, weights) {
+    }
+    result_components eval_fast(smt t1, smt t2, fl r) const {
+      return fused(t1, t2, r);
+    }
+};
+
+//scoring function for t with weights; if builtin names a function with a
+//fused evaluator and t evaluates the same as it, the fused evaluator is
+//used, otherwise plain weighted_terms
+weighted_terms* new_weighted_terms(const terms* t, const flv& weights,
+    const std::string& builtin);
+
+#endif /* FUSED_SCORING_H_ */
@@ -24,19 +24,97 @@
 #include "grid_dim.h"
 #include "common.h"
 
+inline fl stored_value(fl v) {
+  return v;
+}
+
+inline fl stored_value(uint16_t v) {
+  return half_to_float(v);
+}
+
+//read access to half precision values with the interface of array3d<fl>
+struct half_values {
+    const array3d<uint16_t>& values;
+    half_values(const array3d<uint16_t>& v)
+        : values(v) {
+    }
+    sz dim(sz i) const {
+      return values.dim(i);
+    }
+    fl operator()(sz i, sz j, sz k) const {
+      return half_to_float(values(i, j, k));
+    }
+};
+
+//read access to one channel of a brick array
+template<typename T>
+struct brick_values {
+    const brick_array<T>& values;
+    sz channel;
+    brick_values(const brick_array<T>& v, sz c)
+        : values(v), channel(c) {
+    }
+    sz dim(sz i) const {
+      return values.dim(i);
+    }
+    fl operator()(sz i, sz j, sz k) const {
+      return stored_value(values(i, j, k, channel));
+    }
+};
+
+//read access to one channel of one type of a lazy grid
+struct lazy_values {
+    lazy_grid& values;
+    sz slot;
+    sz channel;
+    lazy_values(lazy_grid& v, sz s, sz c)
+        : values(v), slot(s), channel(c) {
+    }
+    sz dim(sz i) const {
+      return values.dim(i);
+    }
+    fl operator()(sz i, sz j, sz k) const {
+      return values.value(i, j, k, slot, channel);
+    }
+};
+
 //evaluate using grid, if deriv is null, do not calc deriviative
 fl grid::evaluate(const atom& a, const vec& location, fl slope, fl c,
     vec *deriv /*=NULL*/) const {
+  if (storage.lazy)
+    return evaluate(lazy_values(*lazy, lazy_slot, 0),
+        lazy_values(*lazy, lazy_slot, 1), lazy->hascharged(), a, location,
+        slope, c, deriv);
+  if (storage.tiled) {
+    if (storage.compact)
+      return evaluate(brick_values<uint16_t>(halfbricks, 0),
+          brick_values<uint16_t>(halfbricks, 1), halfbricks.channels() > 1, a,
+          location, slope, c, deriv);
+    return evaluate(brick_values<fl>(bricks, 0), brick_values<fl>(bricks, 1),
+        bricks.channels() > 1, a, location, slope, c, deriv);
+  }
+  if (storage.compact)
+    return evaluate(half_values(halfdata), half_values(halfchargedata),
+        halfchargedata.dim0() > 0, a, location, slope, c, deriv);
+  return evaluate(data, chargedata, chargedata.dim0() > 0, a, location, slope,
+      c, deriv);
+}
+
+template<typename Values>
+fl grid::evaluate(const Values& values, const Values& chargevalues,
+    bool hascharged, const atom& a, const vec& location, fl slope, fl c,
+    vec *deriv) const {
   //charge indep
-  fl ret = evaluate_aux(data, location, slope, c, deriv);
-  if (a.charge != 0 && chargedata.dim0() > 0) {
+  fl ret = evaluate_aux(values, location, slope, c, deriv);
+  if (a.charge != 0 && hascharged) {
     //charge dependent
     if (deriv == NULL) {
-      ret += a.charge * evaluate_aux(chargedata, location, slope, c, NULL);
+      ret += a.charge * evaluate_aux(chargevalues, location, slope, c, NULL);
     } else //otherwise, must add derivatives
     {
       vec cderiv(0, 0, 0);
-      ret += a.charge * evaluate_aux(chargedata, location, slope, c, &cderiv);
+      ret += a.charge
+          * evaluate_aux(chargevalues, location, slope, c, &cderiv);
       *deriv += a.charge * cderiv;
     }
   }
@@ -49,16 +127,42 @@ fl grid::evaluate_user(const vec& location, fl slope, vec *deriv) const {
 
 //allocate memory for grid (but don't fill in values)
 //only initialize charge dependent values if hashcharged is true
-void grid::init(const grid_dims& gd, bool hascharged) {
-  data.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
-  if (hascharged) chargedata.resize(gd[0].n + 1, gd[1].n + 1, gd[2].n + 1);
+void grid::init(const grid_dims& gd, bool hascharged,
+    const grid_storage& storage_) {
+  storage = storage_;
+  const sz n0 = gd[0].n + 1, n1 = gd[1].n + 1, n2 = gd[2].n + 1;
+  if (storage.tiled) {
+    if (storage.compact)
+      halfbricks.resize(n0, n1, n2, hascharged ? 2 : 1);
+    else
+      bricks.resize(n0, n1, n2, hascharged ? 2 : 1);
+  } else
+    if (storage.compact) {
+      halfdata.resize(n0, n1, n2);
+      if (hascharged) halfchargedata.resize(n0, n1, n2);
+    } else {
+      data.resize(n0, n1, n2);
+      if (hascharged) chargedata.resize(n0, n1, n2);
+    }
+  init_dims(gd);
+}
+
+void grid::init(const grid_dims& gd, const boost::shared_ptr<lazy_grid>& lazy_,
+    smt t) {
+  storage = grid_storage();
+  storage.lazy = true;
+  lazy = lazy_;
+  lazy_slot = lazy->slot(t);
+  init_dims(gd);
+}
+
+void grid::init_dims(const grid_dims& gd) {
   m_init = vec(gd[0].begin, gd[1].begin, gd[2].begin);
   m_range = vec(gd[0].span(), gd[1].span(), gd[2].span());
   assert(m_range[0] > 0);
   assert(m_range[1] > 0);
   assert(m_range[2] > 0);
-  m_dim_fl_minus_1 = vec(data.dim0() - 1.0, data.dim1() - 1.0,
-      data.dim2() - 1.0);
+  m_dim_fl_minus_1 = vec(gd[0].n, gd[1].n, gd[2].n);
   VINA_FOR(i, 3) {
     m_factor[i] = m_dim_fl_minus_1[i] / m_range[i];
     m_factor_inv[i] = 1 / m_factor[i];
@@ -92,7 +196,8 @@ void grid::init(const grid_dims& gd, std::istream& user_in,
   }
 }
 
-fl grid::evaluate_aux(const array3d<fl>& m_data, const vec& location, fl slope,
+template<typename Values>
+fl grid::evaluate_aux(const Values& m_data, const vec& location, fl slope,
     fl v, vec* deriv) const { // sets *deriv if not NULL
   vec s = elementwise_product(location - m_init, m_factor);
 
@@ -24,10 +24,31 @@
 #define VINA_GRID_H
 
 #include "array3d.h"
+#include "brick_array.h"
 #include "grid_dim.h"
 #include "curl.h"
 #include "result_components.h"
 #include "atom.h"
+#include "fp16.h"
+#include "lazy_grid.h"
+
+//how a precomputed (cache) grid stores its values
+struct grid_storage {
+    bool compact; //half precision, halves memory use
+    bool tiled; //4x4x4 bricks with value and charge interleaved per voxel
+    bool lazy; //computed on first use, see lazy_grid
+    sz lazy_max_bytes; //memory limit of a lazy grid, 0 for none
+    grid_storage()
+        : compact(false), tiled(false), lazy(false), lazy_max_bytes(0) {
+    }
+  private:
+    friend class boost::serialization::access;
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned version) {
+      ar & compact;
+      ar & tiled;
+    }
+};
 
 class grid { // FIXME rm 'm_', consistent with my new style
     vec m_init;
@@ -37,6 +58,14 @@ class grid { // FIXME rm 'm_', consistent with my new style
     vec m_factor_inv;
     array3d<fl> data;
     array3d<fl> chargedata; //needs to be multiplied by atom charge
+    //only one of these is used in place of data and chargedata, see storage
+    array3d<uint16_t> halfdata;
+    array3d<uint16_t> halfchargedata;
+    brick_array<fl> bricks; //channel 0 is data, 1 is chargedata
+    brick_array<uint16_t> halfbricks;
+    boost::shared_ptr<lazy_grid> lazy; //shared by the grids of a cache
+    sz lazy_slot; //of this grid's type in lazy
+    grid_storage storage;
 
     friend class cache;
     friend class non_cache;
@@ -44,25 +73,61 @@ class grid { // FIXME rm 'm_', consistent with my new style
   public:
     grid()
         : m_init(0, 0, 0), m_range(1, 1, 1), m_factor(1, 1, 1),
-            m_dim_fl_minus_1(-1, -1, -1), m_factor_inv(1, 1, 1) {
+            m_dim_fl_minus_1(-1, -1, -1), m_factor_inv(1, 1, 1), lazy_slot(0) {
     } // not private
-    grid(const grid_dims& gd, bool hascharged) {
-      init(gd, hascharged);
+    grid(const grid_dims& gd, bool hascharged,
+        const grid_storage& storage_ = grid_storage()) {
+      init(gd, hascharged, storage_);
     }
-    void init(const grid_dims& gd, bool hascharged);
+    void init(const grid_dims& gd, bool hascharged,
+        const grid_storage& storage_ = grid_storage());
     void init(const grid_dims& gd, std::istream& user_in, fl ug_scaling_factor);
+    //values come from the tiles of lazy_, which must cover gd and type t
+    void init(const grid_dims& gd, const boost::shared_ptr<lazy_grid>& lazy_,
+        smt t);
     vec index_to_argument(sz x, sz y, sz z) const {
       return vec(m_init[0] + m_factor_inv[0] * x,
           m_init[1] + m_factor_inv[1] * y, m_init[2] + m_factor_inv[2] * z);
     }
     bool initialized() const {
-      return data.dim0() > 0 && data.dim1() > 0 && data.dim2() > 0;
+      return m_dim_fl_minus_1[0] >= 0 && m_dim_fl_minus_1[1] >= 0
+          && m_dim_fl_minus_1[2] >= 0;
+    }
+    void set(sz x, sz y, sz z, fl value) {
+      if (storage.tiled) {
+        if (storage.compact)
+          halfbricks(x, y, z, 0) = float_to_half(value);
+        else
+          bricks(x, y, z, 0) = value;
+      } else
+        if (storage.compact)
+          halfdata(x, y, z) = float_to_half(value);
+        else
+          data(x, y, z) = value;
+    }
+    void set_charge(sz x, sz y, sz z, fl value) {
+      if (storage.tiled) {
+        if (storage.compact)
+          halfbricks(x, y, z, 1) = float_to_half(value);
+        else
+          bricks(x, y, z, 1) = value;
+      } else
+        if (storage.compact)
+          halfchargedata(x, y, z) = float_to_half(value);
+        else
+          chargedata(x, y, z) = value;
     }
     fl evaluate(const atom& a, const vec& location, fl slope, fl c, vec* deriv =
         NULL) const;
     fl evaluate_user(const vec& location, fl slope, vec* deriv = NULL) const;
   private:
-    fl evaluate_aux(const array3d<fl>& m_data, const vec& location, fl slope,
+    void init_dims(const grid_dims& gd);
+    template<typename Values>
+    fl evaluate(const Values& values, const Values& chargevalues,
+        bool hascharged, const atom& a, const vec& location, fl slope, fl c,
+        vec* deriv) const;
+    template<typename Values>
+    fl evaluate_aux(const Values& m_data, const vec& location, fl slope,
         fl v, vec* deriv) const; // sets *deriv if not NULL
     friend class boost::serialization::access;
     template<class Archive>
@@ -70,6 +135,11 @@ class grid { // FIXME rm 'm_', consistent with my new style
       ar & m_init;
       ar & data;
       ar & chargedata;
+      ar & halfdata;
+      ar & halfchargedata;
+      ar & bricks;
+      ar & halfbricks;
+      ar & storage;
       ar & m_range;
       ar & m_factor;
       ar & m_dim_fl_minus_1;
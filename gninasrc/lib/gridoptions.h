@@ -15,12 +15,18 @@ struct gridoptions {
     string ligmap;
     vector<string> usergrids;
     string examplegrid;
+    string typesfile; //batch mode
+    string data_root;
+    string recmolcache;
+    string ligmolcache;
     double dim;
     double res;
     double subgrid_dim;
     fl randtranslate;
     int verbosity;
     int seed;
+    int cpu;
+    int num_labels;
     bool randrotate;
     bool help;
     bool version;
@@ -32,14 +38,16 @@ struct gridoptions {
     bool gpu;
     bool separate;
     bool use_covalent_radius;
+    bool compress;
     gridoptions()
         :
             //a default dimension of 23.5 yields 48x48x48 gridpoints
             dim(23.5), res(0.5), subgrid_dim(0.0), randtranslate(0.0), 
-            verbosity(1), seed((int) time(NULL)),
+            verbosity(1), seed((int) time(NULL)), cpu(0), num_labels(1),
             randrotate(false), help(false), version(false),
             timeit(false), outmap(false), binary(false), spherize(false),
-            gpu(false), separate(false), use_covalent_radius(false) {
+            gpu(false), separate(false), use_covalent_radius(false),
+            compress(false) {
     }
 };
 
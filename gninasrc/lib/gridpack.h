@@ -0,0 +1,278 @@
+/*
+ * gridpack.h
+ *
+ *  Single file storage of many precomputed grids (e.g., training examples
+ *  produced by gninagrid --types).  Examples are appended back to back,
+ *  optionally gzip compressed, and an offset index with the labels of every
+ *  example is written at the end so readers can memory map the file and
+ *  access any example without touching the filesystem again.
+ *
+ *  Layout:
+ *    gridpack_header
+ *    example data, each example starts on a GRIDPACK_ALIGN boundary
+ *    index: count gridpack_entry records, each followed by num_labels floats
+ *
+ *  Everything is header only since both gninagrid and caffe need it.
+ */
+
+#ifndef GRIDPACK_H_
+#define GRIDPACK_H_
+
+#include <stdint.h>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/copy.hpp>
+
+#define GRIDPACK_MAGIC "GNINAPAK"
+#define GRIDPACK_VERSION 1
+#define GRIDPACK_ALIGN 64
+
+enum gridpack_flags {
+  GRIDPACK_GZIP = 1 //every example is individually gzip compressed
+};
+
+struct gridpack_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint32_t channels;
+    uint32_t dim; //number of grid points on each side
+    uint32_t num_labels;
+    float resolution;
+    uint64_t count; //number of examples
+    uint64_t index_offset; //start of index from beginning of file
+
+    gridpack_header()
+        : version(GRIDPACK_VERSION), flags(0), channels(0), dim(0),
+            num_labels(0), resolution(0), count(0), index_offset(0) {
+      memcpy(magic, GRIDPACK_MAGIC, sizeof(magic));
+    }
+
+    //number of floats in a single uncompressed example
+    size_t example_size() const {
+      return size_t(channels) * dim * dim * dim;
+    }
+};
+
+struct gridpack_entry {
+    uint64_t offset; //from beginning of file
+    uint64_t size; //bytes stored (compressed size if gzipped)
+};
+
+/* Appends examples to a gridpack file.  The header is rewritten with the
+ * location of the index when the file is closed.
+ */
+class gridpack_writer {
+    std::ofstream out;
+    gridpack_header header;
+    std::vector<gridpack_entry> entries;
+    std::vector<float> labels;
+    uint64_t pos;
+
+  public:
+    gridpack_writer()
+        : pos(0) {
+    }
+
+    ~gridpack_writer() {
+      close();
+    }
+
+    //return false if file can not be opened
+    bool open(const std::string& fname, unsigned channels, unsigned dim,
+        float resolution, unsigned num_labels, bool compress) {
+      out.open(fname.c_str(), std::ios::binary | std::ios::trunc);
+      if (!out) return false;
+      header = gridpack_header();
+      header.channels = channels;
+      header.dim = dim;
+      header.resolution = resolution;
+      header.num_labels = num_labels;
+      header.flags = compress ? GRIDPACK_GZIP : 0;
+      entries.clear();
+      labels.clear();
+      out.write((char*) &header, sizeof(header));
+      pos = sizeof(header);
+      return (bool) out;
+    }
+
+    bool is_open() const {
+      return out.is_open();
+    }
+
+    bool compressed() const {
+      return header.flags & GRIDPACK_GZIP;
+    }
+
+    //add an example that has already been prepared with gridpack_encode
+    void append(const std::string& data, const std::vector<float>& exlabels) {
+      //pad so the example is aligned
+      static const char zeros[GRIDPACK_ALIGN] = { 0, };
+      unsigned pad = (GRIDPACK_ALIGN - pos % GRIDPACK_ALIGN) % GRIDPACK_ALIGN;
+      out.write(zeros, pad);
+      pos += pad;
+
+      gridpack_entry e;
+      e.offset = pos;
+      e.size = data.size();
+      entries.push_back(e);
+      out.write(data.data(), data.size());
+      pos += data.size();
+
+      for (unsigned i = 0; i < header.num_labels; i++) {
+        labels.push_back(i < exlabels.size() ? exlabels[i] : 0);
+      }
+    }
+
+    //write out index and finalize header
+    void close() {
+      if (!out.is_open()) return;
+      header.count = entries.size();
+      header.index_offset = pos;
+      for (unsigned i = 0, n = entries.size(); i < n; i++) {
+        out.write((char*) &entries[i], sizeof(gridpack_entry));
+        if (header.num_labels > 0)
+          out.write((char*) &labels[i * header.num_labels],
+              sizeof(float) * header.num_labels);
+      }
+      out.seekp(0);
+      out.write((char*) &header, sizeof(header));
+      out.close();
+    }
+};
+
+//convert an example of n floats into its stored representation
+inline void gridpack_encode(const float *data, size_t n, bool compress,
+    std::string& out) {
+  using namespace boost::iostreams;
+  out.clear();
+  if (compress) {
+    filtering_stream<output> strm;
+    strm.push(gzip_compressor());
+    strm.push(boost::iostreams::back_inserter(out));
+    strm.write((const char*) data, n * sizeof(float));
+    strm.reset(); //flush
+  } else {
+    out.assign((const char*) data, n * sizeof(float));
+  }
+}
+
+/* Memory mapped access to a gridpack file.  Safe to read from multiple
+ * threads once opened.
+ */
+class gridpack_reader {
+    boost::iostreams::mapped_file_source file;
+    gridpack_header header;
+    const char *index;
+
+    //records are not necessarily 8 byte aligned, so copy out
+    const char* record(size_t i) const {
+      return index
+          + i * (sizeof(gridpack_entry) + sizeof(float) * header.num_labels);
+    }
+
+    gridpack_entry entry(size_t i) const {
+      gridpack_entry e;
+      memcpy(&e, record(i), sizeof(e));
+      return e;
+    }
+
+  public:
+    gridpack_reader()
+        : index(NULL) {
+    }
+
+    //return false if fname is not a valid gridpack file
+    bool open(const std::string& fname) {
+      file.open(fname);
+      if (!file.is_open() || file.size() < sizeof(gridpack_header))
+        return false;
+      memcpy(&header, file.data(), sizeof(header));
+      if (memcmp(header.magic, GRIDPACK_MAGIC, sizeof(header.magic)) != 0)
+        return false;
+      if (header.version != GRIDPACK_VERSION)
+        return false;
+      size_t indexsize = header.count
+          * (sizeof(gridpack_entry) + sizeof(float) * header.num_labels);
+      if (header.index_offset + indexsize > file.size())
+        return false;
+      index = file.data() + header.index_offset;
+      return true;
+    }
+
+    const gridpack_header& get_header() const {
+      return header;
+    }
+
+    size_t size() const {
+      return header.count;
+    }
+
+    size_t example_size() const {
+      return header.example_size();
+    }
+
+    bool compressed() const {
+      return header.flags & GRIDPACK_GZIP;
+    }
+
+    float label(size_t i, unsigned l = 0) const {
+      float ret = 0;
+      if (l < header.num_labels)
+        memcpy(&ret, record(i) + sizeof(gridpack_entry) + l * sizeof(float),
+            sizeof(float));
+      return ret;
+    }
+
+    //raw stored data of example i
+    const char* data(size_t i) const {
+      return file.data() + entry(i).offset;
+    }
+
+    size_t stored_size(size_t i) const {
+      return entry(i).size;
+    }
+
+    //copy example i into out, which must have room for example_size() values
+    //return false if stored data is the wrong size
+    template<typename Dtype>
+    bool read(size_t i, Dtype *out) const {
+      using namespace boost::iostreams;
+      size_t n = example_size();
+      size_t nbytes = n * sizeof(float);
+      const float *src = NULL;
+      std::vector<float> tmp;
+
+      if (compressed()) {
+        if (sizeof(Dtype) == sizeof(float))
+          src = (const float*) out;
+        else {
+          tmp.resize(n);
+          src = &tmp[0];
+        }
+        filtering_stream<input> in;
+        in.push(gzip_decompressor());
+        in.push(array_source(data(i), stored_size(i)));
+        array_sink sink((char*) src, nbytes);
+        if (copy(in, sink) != (std::streamsize) nbytes) return false;
+      } else {
+        if (stored_size(i) != nbytes) return false;
+        src = (const float*) data(i);
+      }
+
+      if ((const void*) src != (const void*) out) {
+        for (size_t k = 0; k < n; k++)
+          out[k] = src[k];
+      }
+      return true;
+    }
+};
+
+#endif /* GRIDPACK_H_ */
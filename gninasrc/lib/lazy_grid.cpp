@@ -0,0 +1,143 @@
+/*
+ * lazy_grid.cpp
+ *
+ * Computing, installing and evicting the tiles of a lazy_grid.
+ */
+
+#include "lazy_grid.h"
+#include <algorithm>
+#include "array3d.h"
+
+lazy_grid::lazy_grid(const grid_dims& gd, const shared_receptor& receptor_,
+    const precalculate& p_, const std::vector<smt>& types_, sz max_bytes_)
+    : receptor(receptor_), p(&p_), types(types_),
+        channels(p_.has_components() ? 2 : 1),
+        max_bytes(max_bytes_), bytes(0), freed(0), over_limit(false),
+        clock_hand(0) {
+  VINA_FOR(i, 3) {
+    dims[i] = gd[i].n + 1;
+    tdims[i] = (dims[i] + tile_mask) >> tile_bits;
+    //same arithmetic as grid::init, so points are where populate puts them
+    init[i] = gd[i].begin;
+    fl factor = gd[i].n / gd[i].span();
+    factor_inv[i] = 1 / factor;
+  }
+  num_tiles = checked_multiply(tdims[0], tdims[1], tdims[2]);
+  tile_bytes = sizeof(tile) + tile_voxels * types.size() * channels * sizeof(fl);
+  tiles.reset(new std::atomic<tile*>[num_tiles]);
+  VINA_FOR(i, num_tiles)
+    tiles[i].store(NULL, std::memory_order_relaxed);
+}
+
+lazy_grid::~lazy_grid() {
+  VINA_FOR(i, num_tiles)
+    delete tiles[i].load(std::memory_order_relaxed);
+}
+
+sz lazy_grid::slot(smt t) const {
+  std::vector<smt>::const_iterator pos = std::find(types.begin(), types.end(),
+      t);
+  assert(pos != types.end());
+  return pos - types.begin();
+}
+
+lazy_grid::tile* lazy_grid::compute(sz ti, sz tj, sz tk) const {
+  const sz ntypes = types.size();
+  tile* ret = new tile(tile_voxels * ntypes * channels);
+  const bool haschargeterms = channels > 1;
+  const fl cutoff_sqr = p->cutoff_sqr();
+  //candidates are ascending, like szv_grid's possibilities, so sums match an
+  //eagerly populated grid exactly
+  boost::shared_ptr<const receptor_index> index = receptor.index(p->cutoff());
+  szv possibilities;
+  flv affinities(ntypes), chargeaffinities(haschargeterms ? ntypes : 0);
+
+  VINA_FOR(vk, tile_side) {
+    const sz z = (tk << tile_bits) + vk;
+    if (z >= dims[2]) break;
+    VINA_FOR(vj, tile_side) {
+      const sz y = (tj << tile_bits) + vj;
+      if (y >= dims[1]) break;
+      VINA_FOR(vi, tile_side) {
+        const sz x = (ti << tile_bits) + vi;
+        if (x >= dims[0]) break;
+        std::fill(affinities.begin(), affinities.end(), 0);
+        std::fill(chargeaffinities.begin(), chargeaffinities.end(), 0);
+        const vec probe_coords(init[0] + factor_inv[0] * x,
+            init[1] + factor_inv[1] * y, init[2] + factor_inv[2] * z);
+        index->candidates(probe_coords, possibilities);
+        VINA_FOR_IN(possibilities_i, possibilities) {
+          const atom& a = receptor[possibilities[possibilities_i]];
+          const fl r2 = vec_distance_sqr(a.coords, probe_coords);
+          if (r2 <= cutoff_sqr)
+            add_affinities(*p, a, r2, types, haschargeterms, affinities,
+                chargeaffinities);
+        }
+        const sz voxel = vi + (vj << tile_bits) + (vk << (2 * tile_bits));
+        fl* out = &ret->values[voxel * ntypes * channels];
+        VINA_FOR(j, ntypes) {
+          out[j * channels] = affinities[j];
+          if (haschargeterms) out[j * channels + 1] = chargeaffinities[j];
+        }
+      }
+    }
+  }
+  return ret;
+}
+
+//make t the tile at index, unless another thread got there first
+lazy_grid::tile* lazy_grid::install(sz index, tile* t) {
+  tile* expected = NULL;
+  if (!tiles[index].compare_exchange_strong(expected, t,
+      std::memory_order_acq_rel, std::memory_order_acquire)) {
+    delete t;
+    return expected;
+  }
+  sz total = bytes.fetch_add(tile_bytes) + tile_bytes;
+  if (max_bytes > 0 && total > max_bytes)
+    over_limit.store(true, std::memory_order_relaxed);
+  return t;
+}
+
+//clock (second chance) replacement down to 3/4 of the limit, so that
+//eviction isn't needed again right away; caller holds evict_lock exclusively
+void lazy_grid::evict() {
+  const sz target = max_bytes / 4 * 3;
+  //two passes always suffice, the first clears every referenced flag
+  for (sz n = 0; n < 2 * num_tiles && bytes.load() > target; n++) {
+    tile* t = tiles[clock_hand].load(std::memory_order_relaxed);
+    if (t != NULL) {
+      if (t->referenced.load(std::memory_order_relaxed))
+        t->referenced.store(false, std::memory_order_relaxed);
+      else {
+        tiles[clock_hand].store(NULL, std::memory_order_relaxed);
+        delete t;
+        bytes.fetch_sub(tile_bytes);
+        freed++;
+      }
+    }
+    clock_hand = (clock_hand + 1) % num_tiles;
+  }
+  over_limit.store(false, std::memory_order_relaxed);
+}
+
+sz lazy_grid::tiles_computed() const {
+  return bytes.load() / tile_bytes;
+}
+
+lazy_grid::reader::reader(lazy_grid* g_)
+    : g(g_) {
+  if (g == NULL || g->max_bytes == 0) {
+    g = NULL; //nothing is ever freed, no need to lock
+    return;
+  }
+  if (g->over_limit.load(std::memory_order_relaxed)) {
+    boost::unique_lock<boost::shared_mutex> lock(g->evict_lock);
+    if (g->over_limit.load(std::memory_order_relaxed)) g->evict();
+  }
+  g->evict_lock.lock_shared();
+}
+
+lazy_grid::reader::~reader() {
+  if (g) g->evict_lock.unlock_shared();
+}
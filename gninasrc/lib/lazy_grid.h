@@ -0,0 +1,152 @@
+/*
+ * lazy_grid.h
+ *
+ * Precomputed grid values that are only filled in where they are used.  The
+ * box is split into tiles of 8x8x8 points and a tile, for all the atom types
+ * of the cache, is computed the first time the search interpolates inside
+ * it.  Monte carlo chains spend nearly all their time in a small part of a
+ * whole receptor box, so for blind docking most tiles are never computed.
+ *
+ * Tiles are installed with compare and swap, so any number of threads can
+ * read and fill the grid at once; a tile computed by two threads at the same
+ * time is simply discarded by the loser.  With a memory limit, tiles that
+ * have not been read recently are freed once the limit is exceeded.  Freeing
+ * requires that nobody is in the middle of reading, so every evaluation holds
+ * a reader lock (see reader) while it uses the grid.  Without a limit tiles
+ * are never freed and no locking is done.
+ */
+
+#ifndef LAZY_GRID_H_
+#define LAZY_GRID_H_
+
+#include <atomic>
+#include <memory>
+#include <boost/thread/shared_mutex.hpp>
+#include "grid_dim.h"
+#include "precalculate.h"
+#include "shared_receptor.h"
+
+//sum the contributions of receptor atom a at squared distance r2 to the
+//grid values of each type in needed, as in cache::populate
+inline void add_affinities(const precalculate& p, const atom& a, fl r2,
+    const std::vector<smt>& needed, bool haschargeterms, flv& affinities,
+    flv& chargeaffinities) {
+  const smt t1 = a.get();
+  VINA_FOR_IN(j, needed) {
+    const smt t2 = needed[j];
+    assert(t2 < num_atom_types());
+    //t1 is the receptor atom, a
+    //t2 is type from the ligand, not corresponding to any
+    //particular atom
+    result_components val = p.eval_fast(t1, t2, r2);
+    if (haschargeterms) {
+      //affinities contains the terms that are independent of
+      //the ligand atom charge
+
+      affinities[j] += val[result_components::TypeDependentOnly]
+          + val[result_components::AbsAChargeDependent] * fabs(a.charge);
+      //this component must be multiplied by the ligand atom charge
+      chargeaffinities[j] += val[result_components::AbsBChargeDependent]
+          + val[result_components::ABChargeDependent] * a.charge; //not abs value
+    } else {
+      affinities[j] += val[result_components::TypeDependentOnly];
+    }
+  }
+}
+
+class lazy_grid {
+    struct tile {
+        std::atomic<bool> referenced; //read since the last eviction pass
+        flv values; //by voxel, then type, then channel
+        tile(sz n)
+            : referenced(true), values(n) {
+        }
+    };
+
+    static const sz tile_bits = 3; //tiles are 1 << tile_bits on a side
+    static const sz tile_side = 1 << tile_bits;
+    static const sz tile_mask = tile_side - 1;
+    static const sz tile_voxels = tile_side * tile_side * tile_side;
+
+    sz dims[3]; //in grid points
+    sz tdims[3]; //in tiles
+    vec init;
+    vec factor_inv;
+    shared_receptor receptor; //shares the model's atoms
+    const precalculate* p;
+    std::vector<smt> types;
+    sz channels; //2 if there are charge dependent terms
+    sz tile_bytes;
+
+    std::unique_ptr<std::atomic<tile*>[]> tiles;
+    sz num_tiles;
+
+    //memory limit, 0 for none
+    sz max_bytes;
+    std::atomic<sz> bytes;
+    std::atomic<sz> freed; //tiles evicted so far
+    std::atomic<bool> over_limit;
+    sz clock_hand; //next tile to look at for eviction
+    boost::shared_mutex evict_lock; //shared by readers, exclusive to evict
+
+    tile* compute(sz ti, sz tj, sz tk) const;
+    tile* install(sz index, tile* t);
+    void evict();
+
+  public:
+    lazy_grid(const grid_dims& gd, const shared_receptor& receptor_,
+        const precalculate& p_, const std::vector<smt>& types_,
+        sz max_bytes_);
+    ~lazy_grid();
+
+    sz dim(sz i) const {
+      return dims[i];
+    }
+    bool hascharged() const {
+      return channels > 1;
+    }
+    //position of t in the types this grid was made for
+    sz slot(smt t) const;
+
+    //channel c (0 is the charge independent value) of the type in slot s at
+    //grid point i,j,k, computing its tile if needed.  Only call while holding
+    //a reader.
+    fl value(sz i, sz j, sz k, sz s, sz c) {
+      const sz index = (i >> tile_bits)
+          + tdims[0] * ((j >> tile_bits) + tdims[1] * (k >> tile_bits));
+      tile* t = tiles[index].load(std::memory_order_acquire);
+      if (t == NULL)
+        t = install(index,
+            compute(i >> tile_bits, j >> tile_bits, k >> tile_bits));
+      else
+        if (!t->referenced.load(std::memory_order_relaxed))
+          t->referenced.store(true, std::memory_order_relaxed);
+      const sz voxel = (i & tile_mask) + ((j & tile_mask) << tile_bits)
+          + ((k & tile_mask) << (2 * tile_bits));
+      return t->values[(voxel * types.size() + s) * channels + c];
+    }
+
+    //number of tiles in the box, currently computed, and freed so far, and
+    //the memory the computed tiles use
+    sz total_tiles() const {
+      return num_tiles;
+    }
+    sz tiles_computed() const;
+    sz tiles_freed() const {
+      return freed.load();
+    }
+    sz memory_used() const {
+      return bytes.load();
+    }
+
+    //keeps tiles from being freed while in scope; frees tiles first if the
+    //memory limit was exceeded
+    class reader {
+        lazy_grid* g;
+      public:
+        reader(lazy_grid* g_);
+        ~reader();
+    };
+};
+
+#endif /* LAZY_GRID_H_ */
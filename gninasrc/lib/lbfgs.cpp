@@ -0,0 +1,104 @@
+/*
+ * lbfgs.cpp
+ *
+ * History and two loop recursion for limited memory BFGS.
+ */
+
+#include "lbfgs.h"
+
+void change_to_flv(const change& c, flv& out) {
+  out.clear();
+  out.reserve(c.num_floats());
+  VINA_FOR_IN(i, c.ligands) {
+    const ligand_change& lig = c.ligands[i];
+    VINA_FOR(j, 3)
+      out.push_back(lig.rigid.position[j]);
+    VINA_FOR(j, 3)
+      out.push_back(lig.rigid.orientation[j]);
+    out.insert(out.end(), lig.torsions.begin(), lig.torsions.end());
+  }
+  VINA_FOR_IN(i, c.flex)
+    out.insert(out.end(), c.flex[i].torsions.begin(),
+        c.flex[i].torsions.end());
+  if (c.include_receptor) {
+    VINA_FOR(j, 3)
+      out.push_back(c.receptor.position[j]);
+    VINA_FOR(j, 3)
+      out.push_back(c.receptor.orientation[j]);
+  }
+}
+
+void flv_to_change(const flv& in, change& c) {
+  sz k = 0;
+  VINA_FOR_IN(i, c.ligands) {
+    ligand_change& lig = c.ligands[i];
+    VINA_FOR(j, 3)
+      lig.rigid.position[j] = in[k++];
+    VINA_FOR(j, 3)
+      lig.rigid.orientation[j] = in[k++];
+    VINA_FOR_IN(j, lig.torsions)
+      lig.torsions[j] = in[k++];
+  }
+  VINA_FOR_IN(i, c.flex) {
+    flv& torsions = c.flex[i].torsions;
+    VINA_FOR_IN(j, torsions)
+      torsions[j] = in[k++];
+  }
+  if (c.include_receptor) {
+    VINA_FOR(j, 3)
+      c.receptor.position[j] = in[k++];
+    VINA_FOR(j, 3)
+      c.receptor.orientation[j] = in[k++];
+  }
+  assert(k == in.size());
+}
+
+static fl dot(const flv& a, const flv& b) {
+  fl tmp = 0;
+  VINA_FOR_IN(i, a)
+    tmp += a[i] * b[i];
+  return tmp;
+}
+
+lbfgs_history::lbfgs_history(sz n, sz depth)
+    : s(std::max(depth, sz(1)), flv(n)), y(s.size(), flv(n)), rho(s.size()),
+        a(s.size()), count(0), next(0), gamma(1) {
+}
+
+bool lbfgs_history::update(const flv& s_new, const flv& y_new) {
+  const fl sy = dot(s_new, y_new);
+  if (sy < epsilon_fl) return false; //same test as bfgs_update
+  const fl yy = dot(y_new, y_new);
+
+  s[next] = s_new;
+  y[next] = y_new;
+  rho[next] = 1 / sy;
+  //bfgs rescales its initial identity the same way after the first step
+  gamma = sy / yy;
+  next = (next + 1) % s.size();
+  if (count < s.size()) count++;
+  return true;
+}
+
+void lbfgs_history::minus_product(const flv& g, flv& p) const {
+  const sz m = s.size();
+  p = g;
+  //newest to oldest
+  VINA_FOR(k, count) {
+    sz i = (next + m - 1 - k) % m;
+    a[i] = rho[i] * dot(s[i], p);
+    VINA_FOR_IN(j, p)
+      p[j] -= a[i] * y[i][j];
+  }
+  VINA_FOR_IN(j, p)
+    p[j] *= gamma;
+  //oldest to newest
+  VINA_FOR(k, count) {
+    sz i = (next + m - count + k) % m;
+    fl b = rho[i] * dot(y[i], p);
+    VINA_FOR_IN(j, p)
+      p[j] += s[i][j] * (a[i] - b);
+  }
+  VINA_FOR_IN(j, p)
+    p[j] = -p[j];
+}
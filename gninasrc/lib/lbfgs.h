@@ -0,0 +1,105 @@
+/*
+ * lbfgs.h
+ *
+ * Limited memory BFGS.  Instead of the dense n x n inverse hessian that bfgs
+ * updates every step, only the last few position and gradient differences
+ * are kept and the search direction is computed from them with the two loop
+ * recursion, so a step is O(n * history) instead of O(n^2).  This matters
+ * when flexible residues push the number of degrees of freedom up.
+ */
+
+#ifndef LBFGS_H_
+#define LBFGS_H_
+
+#include "bfgs.h"
+
+//flat copies of the floats of a change, in the order of change::operator()
+void change_to_flv(const change& c, flv& out);
+void flv_to_change(const flv& in, change& c);
+
+class lbfgs_history {
+    std::vector<flv> s; //position differences, ring buffer
+    std::vector<flv> y; //gradient differences
+    flv rho; // 1 / (s^T y)
+    mutable flv a; //two loop scratch
+    sz count; //number of valid pairs
+    sz next; //slot for the next pair
+    fl gamma; //scaling of the initial inverse hessian
+
+  public:
+    lbfgs_history(sz n, sz depth);
+
+    //add the step s with gradient change y, skipped (returning false) if it
+    //would not keep the approximation positive definite
+    bool update(const flv& s_new, const flv& y_new);
+
+    //p = -H g
+    void minus_product(const flv& g, flv& p) const;
+};
+
+template<typename F>
+fl lbfgs(F& f, conf& x, change& g, const fl average_required_improvement,
+    const minimization_params& params) { // x is I/O, final value is returned
+  sz n = g.num_floats();
+  lbfgs_history h(n, params.history);
+  change g_new(g);
+  conf x_new(x);
+  fl f0 = f(x, g);
+  fl f_orig = f0;
+  change g_orig(g);
+  conf x_orig(x);
+
+  change p(g);
+  flv gv, g_newv, pv, s(n), y(n);
+  change_to_flv(g, gv);
+
+  VINA_U_FOR(step, params.maxiters) {
+    h.minus_product(gv, pv);
+    flv_to_change(pv, p);
+    fl f1 = 0;
+    fl alpha;
+
+    if (params.type == minimization_params::LBFGSAccurateLineSearch)
+      alpha = accurate_line_search(f, n, x, g, f0, p, x_new, g_new, f1);
+    else
+      alpha = fast_line_search(f, n, x, g, f0, p, x_new, g_new, f1);
+
+    if (alpha == 0) break; //line direction was wrong, give up
+
+    fl prevf0 = f0;
+    f0 = f1;
+    x = x_new;
+
+    if (params.early_term) {
+      //dkoes - use the progress in reducing the function value as an indication of when to stop
+      fl diff = prevf0 - f0;
+      if (std::fabs(diff) < 1e-5) //arbitrary cutoff
+        break;
+    }
+
+    g = g_new;
+    change_to_flv(g, g_newv);
+    fl gradnormsq = 0;
+    VINA_FOR(i, n) {
+      s[i] = alpha * pv[i];
+      y[i] = g_newv[i] - gv[i];
+      gradnormsq += g_newv[i] * g_newv[i];
+    }
+    gv.swap(g_newv);
+
+    if (!(gradnormsq >= 1e-4)) //slightly arbitrary cutoff - works with fp
+      break; // breaks for nans too
+
+    h.update(s, y);
+  }
+
+  if (!(f0 <= f_orig)) { // succeeds for nans too
+    f0 = f_orig;
+    x = x_orig;
+    g = g_orig;
+  }
+
+  return f0;
+}
+
+#endif /* LBFGS_H_ */
@@ -164,8 +164,25 @@ void context::set(sz pdbqtindex, sz sdfindex, sz atomindex, bool inf) {
   }
 }
 
+//true if appending a model with num_movable atoms renumbers atoms that grid
+//atoms are bonded to
+bool model::grid_bonds_move(sz num_movable) const {
+  if (num_movable == 0) return false;
+  VINA_FOR_IN(i, grid_atoms) {
+    const atom& a = grid_atoms[i];
+    VINA_FOR_IN(j, a.bonds) {
+      const atom_index& b = a.bonds[j].connected_atom_index;
+      if (!b.in_grid && b.i >= m_num_movable_atoms) return true;
+    }
+  }
+  return false;
+}
+
 void model::append(const model& m) {
   deallocate_gpu();
+  //the flat trees are rebuilt from the trees, which need the current frames
+  kinematics.store_frames(ligands, flex);
+  sz first_ligand = ligands.size(), first_residue = flex.size();
   appender t(*this, m);
 
   hydrogens_stripped |= m.hydrogens_stripped;
@@ -200,12 +217,19 @@ void model::append(const model& m) {
 
   t.append(ligands, m.ligands);
   t.append(flex, m.flex);
+  m.kinematics.store_frames(ligands, flex, first_ligand, first_residue);
   t.append(flex_context, m.flex_context);
 
-  t.append(grid_atoms, m.grid_atoms);
+  //appending a ligand leaves the (shared) receptor as is unless receptor
+  //atoms are bonded to our inflex atoms, which move to make room; then the
+  //receptor is copied for every ligand, which is the case with flexible
+  //residues
+  if (!m.grid_atoms.empty() || grid_bonds_move(m.m_num_movable_atoms))
+    t.append(grid_atoms.mutate(), m.grid_atoms.get());
   t.coords_append(atoms, m.atoms);
 
   m_num_movable_atoms += m.m_num_movable_atoms;
+  initialize_kinematics();
 
 //initialize_gpu();
 
@@ -358,6 +382,7 @@ static void striph_update_bonds(const std::vector<int>& gridatommap,
 //Remove hydrogens from model in-place.  Must be called after final assignment of atom types.
 void model::strip_hydrogens() {
   deallocate_gpu();
+  kinematics.store_frames(ligands, flex); //kinematics is rebuilt below
   hydrogens_stripped = true;
   sz N = num_atom_types();
 
@@ -403,7 +428,7 @@ void model::strip_hydrogens() {
   }
 
   //set atoms arrays
-  grid_atoms.swap(newgridatoms);
+  if (!grid_atoms.empty()) grid_atoms.mutate().swap(newgridatoms);
   atoms.swap(newatoms);
 
   m_num_movable_atoms = n_good_moveable;
@@ -426,7 +451,7 @@ void model::strip_hydrogens() {
   }
 
   striph_context(atommap, flex_context);
-
+  initialize_kinematics();
 }
 
 struct branch_metrics {
@@ -721,6 +746,15 @@ void model::initialize(const distance_type_matrix& mobility) {
   assign_bonds(mobility);
   assign_types();
   initialize_pairs(mobility);
+  initialize_kinematics();
+}
+
+void model::initialize_kinematics() {
+  kinematics = flat_tree();
+  VINA_FOR_IN(i, ligands)
+    kinematics.add_ligand(ligands[i]);
+  VINA_FOR_IN(i, flex)
+    kinematics.add_residue(flex[i]);
 }
 
 ///////////////////  end  MODEL::INITIALIZE /////////////////////////
@@ -755,7 +789,7 @@ conf model::get_initial_conf(bool enable_receptor) const { // torsions = 0, orie
   conf tmp(cs, enable_receptor);
   tmp.set_to_null();
   VINA_FOR_IN(i, ligands)
-    tmp.ligands[i].rigid.position = ligands[i].node.get_origin();
+    tmp.ligands[i].rigid.position = kinematics.origin(i);
   return tmp;
 }
 
@@ -915,12 +949,13 @@ void model::sete(const conf& c) {
     c.ligands[i].rigid.apply(internal_coords, coords, ligands[i].begin,
         ligands[i].end);
   /* TODO */
-  flex.set_conf(atoms, coords, c.flex);
+  kinematics.set_flex_conf(atoms, coords, c);
 }
 
 void model::set(const conf& c) {
-  ligands.set_conf(atoms, coords, c.ligands);
-  flex.set_conf(atoms, coords, c.flex);
+  assert(kinematics.num_trees() == ligands.size() + flex.size());
+  //the trees' frames are left stale, see flat_tree::store_frames
+  kinematics.set_conf(atoms, coords, c);
   //for cnn, we do not change the receptor coordinates here
   //instead the cnn layer applies the rigid body transformation, which will
   //apply the inverse of to the ligand when we are done
@@ -954,11 +989,12 @@ std::string model::ligand_atom_str(sz i, sz lig) const {
 fl model::gyration_radius(sz ligand_number) const {
   VINA_CHECK(ligand_number < ligands.size());
   const ligand& lig = ligands[ligand_number];
+  const vec& origin = kinematics.origin(ligand_number);
   fl acc = 0;
   unsigned counter = 0;
   VINA_RANGE(i, lig.begin, lig.end) {
     if (!atoms[i].is_hydrogen()) { // only heavy atoms are used
-      acc += vec_distance_sqr(coords[i], lig.node.get_origin()); // FIXME? check!
+      acc += vec_distance_sqr(coords[i], origin); // FIXME? check!
       ++counter;
     }
   }
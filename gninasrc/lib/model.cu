@@ -219,8 +219,7 @@ fl model::eval_deriv(const precalculate& p, const igrid& ig, const vec& v,
   }
 
   // calculate derivatives
-  ligands.derivative(coords, minus_forces, g.ligands);
-  flex.derivative(coords, minus_forces, g.flex); // inflex forces are ignored
+  kinematics.derivative(coords, minus_forces, g); // inflex forces are ignored
   g.receptor = rec_change; //for cnn
   t.stop();
   return e;
@@ -364,15 +363,16 @@ fl model::eval_intramolecular(const precalculate& p, const vec& v,
   const fl cutoff_sqr = p.cutoff_sqr();
 
   // flex-rigid
+  boost::shared_ptr<const receptor_index> index = get_grid_index(p.cutoff());
+  szv near;
   VINA_FOR(i, num_movable_atoms()) {
     if (find_ligand(i) < ligands.size()) continue; // we only want flex-rigid interaction
     const atom& a = atoms[i];
     smt t1 = a.get();
     if (t1 >= nat || is_hydrogen(t1)) continue;
-    VINA_FOR_IN(j, grid_atoms) {
-      const atom& b = grid_atoms[j];
-      smt t2 = b.get();
-      if (t2 >= nat || is_hydrogen(t2)) continue;
+    index->candidates(coords[i], near);
+    VINA_FOR_IN(k, near) {
+      const atom& b = grid_atoms[near[k]];
       fl r2 = vec_distance_sqr(coords[i], b.coords);
       if (r2 < cutoff_sqr) {
         fl this_e = p.eval(a, b, r2);
@@ -405,6 +405,7 @@ fl model::eval_adjusted(const scoring_function& sf, const precalculate& p,
 }
 
 void model::initialize_gpu() {
+  kinematics.store_frames(ligands, flex); //tree_gpu is built from the trees
   //TODO: only re-malloc if need larger size
   deallocate_gpu();
 
@@ -24,6 +24,7 @@
 #define VINA_MODEL_H
 
 #include <boost/optional.hpp> // for context
+#include <boost/shared_ptr.hpp>
 #include <boost/serialization/utility.hpp>
 #include <string>
 #include "optional_serialization.h"
@@ -38,6 +39,8 @@
 #include "gpucode.h"
 #include "interacting_pairs.h"
 #include "user_opts.h"
+#include "shared_receptor.h"
+#include "flat_tree.h"
 
 typedef std::vector<interacting_pair> interacting_pairs;
 
@@ -305,7 +308,8 @@ struct model {
             grid_atoms(m.grid_atoms), other_pairs(m.other_pairs),
             hydrogens_stripped(m.hydrogens_stripped),
             internal_coords(m.internal_coords), flex(m.flex),
-            flex_context(m.flex_context), name(m.name), pose_num(m.pose_num) {
+            flex_context(m.flex_context), name(m.name), pose_num(m.pose_num),
+            kinematics(m.kinematics) {
     }
 
     void append(const model& m);
@@ -498,7 +502,12 @@ struct model {
     fl clash_penalty() const;
 
     const atomv& get_fixed_atoms() const {
-      return grid_atoms;
+      return grid_atoms.get();
+    }
+    //spatial index of grid_atoms for exact scoring, built on first use and
+    //shared by copies of this model
+    boost::shared_ptr<const receptor_index> get_grid_index(fl cutoff) const {
+      return grid_atoms.index(cutoff);
     }
     const atomv& get_movable_atoms() const {
       return atoms;
@@ -529,7 +538,7 @@ struct model {
     vector_mutable<ligand> ligands;
     sz m_num_movable_atoms;
     atomv atoms; // movable, inflex
-    atomv grid_atoms;
+    shared_receptor grid_atoms; //shared by copies, see mutate()
     interacting_pairs other_pairs;
 
     //for cnn, allow rigid body movement of receptor
@@ -551,13 +560,38 @@ struct model {
     friend struct pdbqt_initializer;
     friend struct model_test;
     friend void test_eval_intra();
+    friend class boost::serialization::access;
+
+    //everything needed to reuse a prepared receptor (see MolGetter)
+    template<class Archive>
+    void serialize(Archive& ar, const unsigned version) {
+      if (Archive::is_saving::value) kinematics.store_frames(ligands, flex);
+      ar & tree_width;
+      ar & coords;
+      ar & minus_forces;
+      ar & ligands;
+      ar & m_num_movable_atoms;
+      ar & atoms;
+      ar & grid_atoms;
+      ar & other_pairs;
+      ar & hydrogens_stripped;
+      ar & internal_coords;
+      ar & flex;
+      ar & flex_context;
+      ar & name;
+      ar & pose_num;
+      //atom serialization omits bonds, but append and strip_hydrogens need them
+      VINA_FOR_IN(i, atoms)
+        ar & atoms[i].bonds;
+      if (Archive::is_loading::value) initialize_kinematics();
+    }
 
     const atom& get_atom(const atom_index& i) const {
       return (i.in_grid ? grid_atoms[i.i] : atoms[i.i]);
     }
 
     atom& get_atom(const atom_index& i) {
-      return (i.in_grid ? grid_atoms[i.i] : atoms[i.i]);
+      return (i.in_grid ? grid_atoms.mutate()[i.i] : atoms[i.i]);
     }
 
     void write_context(const context& c, std::ostream& out) const;
@@ -589,6 +623,11 @@ struct model {
     void assign_types();
     void initialize_pairs(const distance_type_matrix& mobility);
     void initialize(const distance_type_matrix& mobility);
+    //flatten ligands and flex, must be redone whenever their structure changes
+    void initialize_kinematics();
+    //if true, append has to renumber grid atom bonds and so gives this model
+    //its own copy of the receptor instead of sharing it
+    bool grid_bonds_move(sz num_movable) const;
     fl clash_penalty_aux(const interacting_pairs& pairs) const;
 
     fl eval_interacting_pairs(const precalculate& p, fl v,
@@ -614,6 +653,9 @@ struct model {
 
     std::string name;
     int pose_num;
+
+    //used by set and eval_deriv in place of ligands and flex
+    flat_tree kinematics;
 };
 
 #endif
@@ -7,17 +7,23 @@
 #include "molgetter.h"
 #include "parse_pdbqt.h"
 #include "parsing.h"
+#include <set>
 #include <openbabel/mol.h>
 #include <openbabel/obconversion.h>
 #include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/timer/timer.hpp>
 #include "GninaConverter.h"
+#include "my_pid.h"
 
 //create the initial model from the specified receptor files
 //mostly because Matt kept complaining about it, this will automatically create
 //pdbqts if necessary using open babel
 void MolGetter::create_init_model(const std::string& rigid_name,
-    const std::string& flex_name, FlexInfo& finfo, tee& log) {
+    const std::string& flex_name, FlexInfo& finfo, tee& log,
+    const std::string& receptor_cache) {
   if (rigid_name.size() > 0) {
     //support specifying flexible residues explicitly as pdbqt, but only
     //in compatibility mode where receptor is pdbqt as well
@@ -39,52 +45,17 @@ void MolGetter::create_init_model(const std::string& rigid_name,
         ifile rigidin(rigid_name);
         initm = parse_receptor_pdbqt(rigid_name, rigidin);
       } else {
-        //default, openbabel mode
-        using namespace OpenBabel;
-        obmol_opener fileopener;
-        OBConversion conv;
-        conv.SetOutFormat("PDBQT");
-        conv.AddOption("r", OBConversion::OUTOPTIONS); //rigid molecule, otherwise really slow and useless analysis is triggered
-        conv.AddOption("c", OBConversion::OUTOPTIONS); //single combined molecule
-        fileopener.openForInput(conv, rigid_name);
-        OBMol rec;
-        if (!conv.Read(&rec)) throw file_error(rigid_name, true);
-
-        rec.AddHydrogens(true);
-        FOR_ATOMS_OF_MOL(a, rec){
-          a->GetPartialCharge();
-        }
-        OBMol rigid;
-        std::string flexstr;
-
-        if(rec.NumResidues() > 0){
-          try{
-            // Can fail with std::runtime_error if `--flex_limit` is set
-            finfo.extractFlex(rec, rigid, flexstr);
-          }
-          catch(std::runtime_error &e){
-            // --flex_limit exceeded; print error and quit
-            log << e.what() << "\n";
-            std::exit(-1);
-          }
+        //default, openbabel mode, which is slow enough to be worth caching
+        path cachefile;
+        std::string key;
+        if (receptor_cache.size() > 0) {
+          key = receptor_cache_key(rigid_name, finfo);
+          cachefile = path(receptor_cache) / receptor_cache_name(key);
         }
-        else{
-          // No information about residues, whole receptor treated as rigid
-          rigid = rec;
+        if (cachefile.empty() || !load_cached_receptor(cachefile, key, finfo)) {
+          create_init_model_ob(rigid_name, flex_name, finfo, log);
+          if (!cachefile.empty()) save_cached_receptor(cachefile, key, finfo);
         }
-
-        std::string recstr = conv.WriteString(&rigid);
-        std::stringstream recstream(recstr);
-        
-        if (flexstr.size() > 0) //have flexible component
-        {
-          std::stringstream flexstream(flexstr);
-          initm = parse_receptor_pdbqt(rigid_name, recstream, flex_name,
-              flexstream);
-        } else { //rigid only
-          initm = parse_receptor_pdbqt(rigid_name, recstream);
-        }
-
       }
 
   }
@@ -92,6 +63,153 @@ void MolGetter::create_init_model(const std::string& rigid_name,
   if (strip_hydrogens) initm.strip_hydrogens();
 }
 
+//prepare a non-pdbqt receptor with openbabel: add hydrogens and charges,
+//extract flexible residues and parse the result as pdbqt
+void MolGetter::create_init_model_ob(const std::string& rigid_name,
+    const std::string& flex_name, FlexInfo& finfo, tee& log) {
+  using namespace OpenBabel;
+  obmol_opener fileopener;
+  OBConversion conv;
+  conv.SetOutFormat("PDBQT");
+  conv.AddOption("r", OBConversion::OUTOPTIONS); //rigid molecule, otherwise really slow and useless analysis is triggered
+  conv.AddOption("c", OBConversion::OUTOPTIONS); //single combined molecule
+  fileopener.openForInput(conv, rigid_name);
+  OBMol rec;
+  if (!conv.Read(&rec)) throw file_error(rigid_name, true);
+
+  rec.AddHydrogens(true);
+  FOR_ATOMS_OF_MOL(a, rec){
+    a->GetPartialCharge();
+  }
+  OBMol rigid;
+  std::string flexstr;
+
+  if(rec.NumResidues() > 0){
+    try{
+      // Can fail with std::runtime_error if `--flex_limit` is set
+      finfo.extractFlex(rec, rigid, flexstr);
+    }
+    catch(std::runtime_error &e){
+      // --flex_limit exceeded; print error and quit
+      log << e.what() << "\n";
+      std::exit(-1);
+    }
+  }
+  else{
+    // No information about residues, whole receptor treated as rigid
+    rigid = rec;
+  }
+
+  std::string recstr = conv.WriteString(&rigid);
+  std::stringstream recstream(recstr);
+
+  if (flexstr.size() > 0) //have flexible component
+  {
+    std::stringstream flexstream(flexstr);
+    initm = parse_receptor_pdbqt(rigid_name, recstream, flex_name,
+        flexstream);
+  } else { //rigid only
+    initm = parse_receptor_pdbqt(rigid_name, recstream);
+  }
+}
+
+//bump if the serialized model changes
+#define RECEPTOR_CACHE_VERSION 3
+
+//64 bit FNV-1a, stable across runs and platforms unlike std::hash
+static boost::uint64_t fnv1a_hash(const char *data, size_t n,
+    boost::uint64_t h = 14695981039346656037ULL) {
+  for (size_t i = 0; i < n; i++) {
+    h ^= (unsigned char) data[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+//the prepared receptor depends on the file contents and the flex settings
+std::string MolGetter::receptor_cache_key(const std::string& rigid_name,
+    const FlexInfo& finfo) {
+  std::ifstream in(rigid_name.c_str(), std::ios::binary);
+  if (!in) throw file_error(rigid_name, true);
+  std::string contents((std::istreambuf_iterator<char>(in)),
+      std::istreambuf_iterator<char>());
+
+  std::stringstream key;
+  key << "gnina receptor v" << RECEPTOR_CACHE_VERSION << " "
+      << path(rigid_name).filename().string() << " " << contents.size() << " "
+      << std::hex << fnv1a_hash(contents.data(), contents.size()) << std::dec
+      << " " << finfo.cacheKey();
+  return key.str();
+}
+
+std::string MolGetter::receptor_cache_name(const std::string& key) {
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0')
+      << fnv1a_hash(key.data(), key.size()) << ".recmodel";
+  return name.str();
+}
+
+//load initm, and the flexible residues it was prepared with into finfo, from
+//fname if it was stored with key, return false otherwise
+bool MolGetter::load_cached_receptor(const path& fname, const std::string& key,
+    FlexInfo& finfo) {
+  std::ifstream in(fname.string().c_str(), std::ios::binary);
+  if (!in) return false;
+  try {
+    boost::archive::binary_iarchive serialin(in);
+    std::string storedkey;
+    serialin >> storedkey;
+    if (storedkey != key) return false; //hash collision
+    model m;
+    serialin >> m;
+    //chain, resid and insertion code of each flexible residue
+    sz nres = 0;
+    serialin >> nres;
+    std::vector<std::tuple<char, int, char> > residues;
+    for (sz i = 0; i < nres; i++) {
+      char chain = 0, icode = 0;
+      int resid = 0;
+      serialin >> chain >> resid >> icode;
+      residues.push_back(std::make_tuple(chain, resid, icode));
+    }
+    initm = m;
+    finfo.setResidues(residues);
+  } catch (boost::archive::archive_exception& e) {
+    return false; //truncated or written by an incompatible build
+  }
+  return true;
+}
+
+//store initm, failures are not fatal since the cache is only an optimization
+void MolGetter::save_cached_receptor(const path& fname,
+    const std::string& key, const FlexInfo& finfo) const {
+  //write to a private file and rename so concurrent jobs never see partial
+  //files
+  std::stringstream tmpname;
+  tmpname << fname.string() << "." << my_pid() << ".tmp";
+  try {
+    boost::filesystem::create_directories(fname.parent_path());
+    {
+      std::ofstream out(tmpname.str().c_str(), std::ios::binary);
+      if (!out) return;
+      boost::archive::binary_oarchive serialout(out);
+      serialout << key;
+      serialout << initm;
+      std::vector<std::tuple<char, int, char> > residues = finfo.getResidues();
+      sz nres = residues.size();
+      serialout << nres;
+      for (sz i = 0; i < nres; i++) {
+        serialout << std::get<0>(residues[i]) << std::get<1>(residues[i])
+            << std::get<2>(residues[i]);
+      }
+    }
+    boost::filesystem::rename(tmpname.str(), fname);
+  } catch (std::exception& e) {
+    boost::system::error_code ec;
+    boost::filesystem::remove(tmpname.str(), ec);
+  }
+}
+
 //setup for reading from fname
 void MolGetter::setInputFile(const std::string& fname) {
   if (fname.size() > 0) //zer if no_lig
@@ -117,7 +235,7 @@ void MolGetter::setInputFile(const std::string& fname) {
             infileopener.clear();
             infileopener.openForInput(conv, fname);
             VINA_CHECK(conv.SetOutFormat("PDBQT"));
-
+            have_pending = false;
           }
   }
 }
@@ -212,3 +330,156 @@ bool MolGetter::readMoleculeIntoModel(model &m) {
   return false; //shouldn't get here
 #endif
 }
+
+//true if a and b have the same elements in the same order, bonded the same
+//way, i.e. they are conformers of one molecule
+static bool same_connectivity(OpenBabel::OBMol& a, OpenBabel::OBMol& b) {
+  if (a.NumAtoms() != b.NumAtoms() || a.NumBonds() != b.NumBonds())
+    return false;
+  for (unsigned i = 1; i <= a.NumAtoms(); i++)
+    if (a.GetAtom(i)->GetAtomicNum() != b.GetAtom(i)->GetAtomicNum())
+      return false;
+  for (unsigned i = 0; i < a.NumBonds(); i++) {
+    OpenBabel::OBBond* ab = a.GetBond(i);
+    OpenBabel::OBBond* bb = b.GetBond(i);
+    if (ab->GetBeginAtomIdx() != bb->GetBeginAtomIdx()
+        || ab->GetEndAtomIdx() != bb->GetEndAtomIdx()
+        || ab->GetBondOrder() != bb->GetBondOrder())
+      return false;
+  }
+  return true;
+}
+
+//read the next molecule with all its consecutive conformers.  OpenBabel's
+//readconformer option can't be used: the format only groups records when it
+//can seek back in the input, and ligand files are read through a filtering
+//(possibly gzip) stream
+bool MolGetter::readConformers(OpenBabel::OBMol& mol) {
+  if (have_pending) {
+    mol = pending;
+    have_pending = false;
+  } else
+    if (!conv.Read(&mol)) return false;
+
+  pending.Clear();
+  while (conv.Read(&pending)) {
+    if (!same_connectivity(mol, pending)) {
+      have_pending = true;
+      break;
+    }
+    double* coords = new double[3 * pending.NumAtoms()];
+    std::copy(pending.GetCoordinates(),
+        pending.GetCoordinates() + 3 * pending.NumAtoms(), coords);
+    mol.AddConformer(coords); //takes ownership
+    pending.Clear();
+  }
+  return true;
+}
+
+//ligand model of conformer i as converted by mc
+static model conformer_model(GninaConverter::MCMolConverter& mc, unsigned i) {
+  parsing_struct p;
+  context c;
+  unsigned torsdof = mc.convertConformer(i, p, c);
+  non_rigid_parsed nr;
+  postprocess_ligand(nr, p, c, torsdof);
+  VINA_CHECK(nr.atoms_atoms_bonds.dim() == nr.atoms.size());
+
+  pdbqt_initializer tmp;
+  tmp.initialize_from_nrp(nr, c, true);
+  tmp.initialize(nr.mobility_matrix());
+  return tmp.m;
+}
+
+typedef std::set<std::pair<sz, sz> > bond_set;
+
+//the bonds flexible treats as rotatable, as pairs of the indices of the same
+//atoms in rigid; the two models are of the same conformer, so atoms are
+//matched by position
+static bond_set rotatable_bonds(const model& flexible, const model& rigid) {
+  VINA_CHECK(flexible.atoms.size() == rigid.atoms.size());
+  std::vector<sz> to_rigid(flexible.atoms.size(), rigid.atoms.size());
+  VINA_FOR_IN(i, flexible.atoms) {
+    fl closest = max_fl;
+    VINA_FOR_IN(j, rigid.atoms) {
+      fl d = vec_distance_sqr(flexible.coords[i], rigid.coords[j]);
+      if (d < closest) {
+        closest = d;
+        to_rigid[i] = j;
+      }
+    }
+    VINA_CHECK(closest < 0.01);
+  }
+
+  bond_set ret;
+  VINA_FOR_IN(i, flexible.atoms) {
+    VINA_FOR_IN(k, flexible.atoms[i].bonds) {
+      const bond& b = flexible.atoms[i].bonds[k];
+      if (b.rotatable && !b.connected_atom_index.in_grid)
+        ret.insert(std::make_pair(to_rigid[i],
+            to_rigid[b.connected_atom_index.i]));
+    }
+  }
+  return ret;
+}
+
+//a rigid conformer has no rotors of its own; marking the bonds that would be
+//rotatable keeps the conformation independent terms (num_tors etc.) the same
+//as when docking the conformer flexibly
+static void mark_rotatable(model& rigid, const bond_set& rotatable) {
+  VINA_FOR_IN(i, rigid.atoms) {
+    VINA_FOR_IN(k, rigid.atoms[i].bonds) {
+      bond& b = rigid.atoms[i].bonds[k];
+      b.rotatable = !b.connected_atom_index.in_grid
+          && rotatable.count(std::make_pair(i, b.connected_atom_index.i)) > 0;
+    }
+  }
+}
+
+bool MolGetter::readConformersIntoModels(boost::ptr_vector<model>& models) {
+  if (type != OB) {
+    model *m = new model;
+    if (!readMoleculeIntoModel(*m)) {
+      delete m;
+      return false;
+    }
+    models.push_back(m);
+    return true;
+  }
+
+  OpenBabel::OBMol mol;
+  while (readConformers(mol)) {
+    std::string name = mol.GetTitle();
+    mol.StripSalts();
+    boost::ptr_vector<model> conformers;
+    try {
+      GninaConverter::MCMolConverter mc(mol, true, add_hydrogens);
+      unsigned n = mc.numConformers();
+      bond_set rotatable;
+      if (n > 0) {
+        //only the search is rigid, the rotors are those of normal docking
+        GninaConverter::MCMolConverter flexmc(mol, false, add_hydrogens);
+        rotatable = rotatable_bonds(conformer_model(flexmc, 0),
+            conformer_model(mc, 0));
+      }
+      for (unsigned i = 0; i < n; i++) {
+        model lig = conformer_model(mc, i);
+        mark_rotatable(lig, rotatable);
+        if (strip_hydrogens) lig.strip_hydrogens();
+
+        conformers.push_back(new model);
+        conformers.back() = initm;
+        conformers.back().set_name(name);
+        conformers.back().append(lig);
+      }
+      models.transfer(models.end(), conformers);
+      return true;
+    } catch (parse_error& e) {
+      std::cerr << "\n\nParse error with molecule " << mol.GetTitle()
+          << " in file \"" << e.file.string() << "\": " << e.reason << '\n';
+      continue;
+    }
+  }
+
+  return false; //no valid molecules read
+}
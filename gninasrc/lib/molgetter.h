@@ -8,6 +8,7 @@
 #ifndef MOLGETTER_H_
 #define MOLGETTER_H_
 
+#include <boost/ptr_container/ptr_vector.hpp>
 #include "model.h"
 #include "obmolopener.h"
 #include "flexinfo.h"
@@ -30,6 +31,10 @@ class MolGetter {
     //openbabel data structs
     OpenBabel::OBConversion conv;
     obmol_opener infileopener;
+    //the record readConformers read past the last conformer of the molecule
+    //it returned
+    OpenBabel::OBMol pending;
+    bool have_pending;
 
     //smina data structs
     izfile infile;
@@ -37,23 +42,38 @@ class MolGetter {
     //pdbqt data
     bool pdbqtdone;
 
+    void create_init_model_ob(const std::string& rigid_name,
+        const std::string& flex_name, FlexInfo& finfo, tee& log);
+    static std::string receptor_cache_key(const std::string& rigid_name,
+        const FlexInfo& finfo);
+    static std::string receptor_cache_name(const std::string& key);
+    bool load_cached_receptor(const path& fname, const std::string& key,
+        FlexInfo& finfo);
+    void save_cached_receptor(const path& fname, const std::string& key,
+        const FlexInfo& finfo) const;
+    bool readConformers(OpenBabel::OBMol& mol);
+
   public:
 
     MolGetter(bool addH = true, bool stripH = true)
-        : add_hydrogens(addH), strip_hydrogens(stripH), type(NONE),
-            pdbqtdone(false) {
+        : add_hydrogens(addH), strip_hydrogens(stripH),
+            have_pending(false), type(NONE), pdbqtdone(false) {
     }
 
     MolGetter(const std::string& rigid_name, const std::string& flex_name,
-        FlexInfo& finfo, bool addH, bool stripH, tee& log)
-        : add_hydrogens(addH), strip_hydrogens(stripH), type(NONE),
-            pdbqtdone(false) {
-      create_init_model(rigid_name, flex_name, finfo, log);
+        FlexInfo& finfo, bool addH, bool stripH, tee& log,
+        const std::string& receptor_cache = "")
+        : add_hydrogens(addH), strip_hydrogens(stripH),
+            have_pending(false), type(NONE), pdbqtdone(false) {
+      create_init_model(rigid_name, flex_name, finfo, log, receptor_cache);
     }
 
     //create the initial model from the specified receptor files
+    //if receptor_cache is a directory, receptors that need openbabel
+    //preparation are stored there and reused by later runs
     void create_init_model(const std::string& rigid_name,
-        const std::string& flex_name, FlexInfo& finfo, tee& log);
+        const std::string& flex_name, FlexInfo& finfo, tee& log,
+        const std::string& receptor_cache = "");
 
     //setup for reading from fname
     void setInputFile(const std::string& fname);
@@ -62,6 +82,13 @@ class MolGetter {
     //return false if no molecule available;
     bool readMoleculeIntoModel(model &m);
 
+    //add one model per conformer of the next molecule, each initm plus the
+    //conformer as a single rigid body; consecutive openbabel records with
+    //the same connectivity are conformers of one molecule, other input gives
+    //one flexible model
+    //return false if no molecule available
+    bool readConformersIntoModels(boost::ptr_vector<model>& models);
+
     //return model without ligand
     const model& getInitModel() const {
       return initm;
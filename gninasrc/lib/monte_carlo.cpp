@@ -92,16 +92,27 @@ output_type monte_carlo::many_runs(model& m, const precalculate& p, igrid& ig,
 void monte_carlo::operator()(model& m, output_container& out,
     const precalculate& p, igrid& ig, const vec& corner1, const vec& corner2,
     incrementable* increment_me, rng& generator, grid& user_grid) const {
-  vec authentic_v(1000, 1000, 1000); // FIXME? this is here to avoid max_fl/max_fl
   conf_size s = m.get_size();
-  change g(s, ig.move_receptor());
   output_type tmp(conf(s, ig.move_receptor()), 0);
   tmp.c.randomize(corner1, corner2, generator);
   fl best_e = max_fl;
+  run(m, out, tmp, best_e, 0, num_steps, temperature, p, ig, increment_me,
+      generator, user_grid);
+  VINA_CHECK(!out.empty());
+  VINA_CHECK(out.front().e <= out.back().e); // make sure the sorting worked in the correct order
+}
+
+void monte_carlo::run(model& m, output_container& out, output_type& tmp,
+    fl& best_e, unsigned first, unsigned steps, fl temp,
+    const precalculate& p, igrid& ig, incrementable* increment_me,
+    rng& generator, grid& user_grid) const {
+  vec authentic_v(1000, 1000, 1000); // FIXME? this is here to avoid max_fl/max_fl
+  conf_size s = m.get_size();
+  change g(s, ig.move_receptor());
   minimization_params minparms = ssd_par.minparm;
   if (minparms.maxiters == 0) minparms.maxiters = ssd_par.evals;
   quasi_newton quasi_newton_par(minparms);
-  VINA_U_FOR(step, num_steps) {
+  for (unsigned step = first; step < first + steps; ++step) {
     if (increment_me) ++(*increment_me);
     output_type candidate = tmp;
     mutate_conf(candidate.c, m, mutation_amplitude, generator);
@@ -111,7 +122,7 @@ void monte_carlo::operator()(model& m, output_container& out,
       quasi_newton_par(m, p, ig, candidate, g, hunt_cap, user_grid);
 
     if (step == 0
-        || metropolis_accept(tmp.e, candidate.e, temperature, generator)) {
+        || metropolis_accept(tmp.e, candidate.e, temp, generator)) {
       tmp = candidate;
 
       m.set(tmp.c); // FIXME? useless?
@@ -128,6 +139,4 @@ void monte_carlo::operator()(model& m, output_container& out,
       }
     }
   }
-  VINA_CHECK(!out.empty());
-  VINA_CHECK(out.front().e <= out.back().e); // make sure the sorting worked in the correct order
 }
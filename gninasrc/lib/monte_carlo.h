@@ -52,6 +52,12 @@ struct monte_carlo {
     void operator()(model& m, output_container& out, const precalculate& p,
         igrid& ig, const vec& corner1, const vec& corner2,
         incrementable* increment_me, rng& generator, grid& user_grid) const;
+    // continue a chain at current for steps first to first+steps-1 at the
+    // given temperature; best_e is the best energy the chain has saved so far
+    void run(model& m, output_container& out, output_type& current,
+        fl& best_e, unsigned first, unsigned steps, fl temp,
+        const precalculate& p, igrid& ig, incrementable* increment_me,
+        rng& generator, grid& user_grid) const;
     void many_runs(model& m, output_container& out, const precalculate& p,
         igrid& ig, const vec& corner1, const vec& corner2, sz num_runs,
         rng& generator, grid& user_grid) const;
@@ -31,6 +31,10 @@ fl naive_non_cache::eval(const model& m, fl v) const { // needs m.coords
   const fl cutoff_sqr = p->cutoff_sqr();
 
   sz n = num_atom_types();
+  //only receptor atoms near each ligand atom, in the original order
+  boost::shared_ptr<const receptor_index> index = m.get_grid_index(
+      p->cutoff());
+  szv near;
 
   VINA_FOR(i, m.num_movable_atoms()) {
     fl this_e = 0;
@@ -39,10 +43,9 @@ fl naive_non_cache::eval(const model& m, fl v) const { // needs m.coords
     if (t1 >= n || is_hydrogen(t1)) continue;
     const vec& a_coords = m.coords[i];
 
-    VINA_FOR_IN(j, m.grid_atoms) {
-      const atom& b = m.grid_atoms[j];
-      smt t2 = b.get();
-      if (t2 >= n || is_hydrogen(t2)) continue;
+    index->candidates(a_coords, near);
+    VINA_FOR_IN(k, near) {
+      const atom& b = m.grid_atoms[near[k]];
       vec r_ba;
       r_ba = a_coords - b.coords;
       fl r2 = sqr(r_ba);
@@ -39,18 +39,13 @@ void obmol_opener::openForInput(OBConversion& conv, const std::string& name) {
   //dkoes - annoyingly, although openbabel is smart enough to ignore
   //the .gz at the end of a file when determining the file format, it
   //does not actually open the file as a gzip stream
-  std::ifstream *uncompressed_inmol = new std::ifstream(name.c_str());
-  streams.push_back(uncompressed_inmol);
+  std::string::size_type pos = name.rfind(".gz");
+  readahead_source infile(name, pos != std::string::npos);
   filtering_stream<input> *inmol = new filtering_stream<input>();
   streams.push_back((std::istream*) inmol);
+  inmol->push(infile);
 
-  std::string::size_type pos = name.rfind(".gz");
-  if (pos != std::string::npos) {
-    inmol->push(gzip_decompressor());
-  }
-  inmol->push(*uncompressed_inmol);
-
-  if (!*uncompressed_inmol || !*inmol) {
+  if (!infile.is_open() || !*inmol) {
     throw file_error(path(name), true);
   }
   conv.SetInStream((std::istream*) inmol);
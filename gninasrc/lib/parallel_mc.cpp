@@ -33,8 +33,12 @@ struct parallel_mc_task {
     model m;
     output_container out;
     rng generator;
-    parallel_mc_task(const model& m_, int seed)
-        : m(m_), generator(static_cast<rng::result_type>(seed)) {
+    const search_region* region;
+    sz conformer;
+    parallel_mc_task(const model& m_, int seed, const search_region* region_,
+        sz conformer_ = 0)
+        : m(m_), generator(static_cast<rng::result_type>(seed)),
+            region(region_), conformer(conformer_) {
       if (m_.gpu_initialized()) {
         //TODO: need to ensure that worker threads using these copies can't
         //deallocate GPU memory - race condition in
@@ -60,22 +64,56 @@ struct parallel_mc_task {
 
 typedef boost::ptr_vector<parallel_mc_task> parallel_mc_task_container;
 
+//a chain of a replica exchange ladder, which keeps its state between the
+//segments of steps run on the thread pool
+struct replica_task : public parallel_mc_task {
+    output_type current; //swapped with neighboring temperatures
+    fl best_e;
+    fl temperature;
+    replica_task(const model& m_, int seed, const search_region* region_,
+        fl temperature_, bool move_receptor)
+        : parallel_mc_task(m_, seed, region_),
+            current(conf(m_.get_size(), move_receptor), 0), best_e(max_fl),
+            temperature(temperature_) {
+      current.c.randomize(region->corner1, region->corner2, generator);
+    }
+};
+
+typedef boost::ptr_vector<replica_task> replica_task_container;
+
+//runs the next segment of steps of each replica; cpu scoring only
+struct replica_aux {
+    const monte_carlo* mc;
+    const precalculate* p;
+    parallel_progress* pg;
+    grid* user_grid;
+    unsigned first;
+    unsigned steps;
+    replica_aux(const monte_carlo* mc_, const precalculate* p_,
+        parallel_progress* pg_, grid* user_grid_)
+        : mc(mc_), p(p_), pg(pg_), user_grid(user_grid_), first(0), steps(0) {
+    }
+
+    void operator()(replica_task& t) const {
+      mc->run(t.m, t.out, t.current, t.best_e, first, steps, t.temperature,
+          *p, *t.region->ig, pg, t.generator, *user_grid);
+    }
+};
+
 struct parallel_mc_aux {
     const monte_carlo* mc;
     const precalculate* p;
-    igrid* ig;
-    const vec* corner1;
-    const vec* corner2;
     parallel_progress* pg;
     grid* user_grid;
-    parallel_mc_aux(const monte_carlo* mc_, const precalculate* p_, igrid* ig_,
-        const vec* corner1_, const vec* corner2_, parallel_progress* pg_,
-        grid* user_grid_)
-        : mc(mc_), p(p_), ig(ig_), corner1(corner1_), corner2(corner2_),
-            pg(pg_), user_grid(user_grid_) {
+    parallel_mc_aux(const monte_carlo* mc_, const precalculate* p_,
+        parallel_progress* pg_, grid* user_grid_)
+        : mc(mc_), p(p_), pg(pg_), user_grid(user_grid_) {
     }
 
     void operator()(parallel_mc_task& t) const {
+      igrid* ig = t.region->ig;
+      const vec* corner1 = &t.region->corner1;
+      const vec* corner2 = &t.region->corner2;
       //TODO: remove when the CNN is using the device buffer
       const non_cache_cnn* cnn = dynamic_cast<const non_cache_cnn*>(ig);
       if (t.m.gpu_initialized() && !cnn) {
@@ -152,6 +190,8 @@ struct parallel_mc_aux {
       } else
         (*mc)(t.m, t.out, *p, *ig, *corner1, *corner2, pg, t.generator,
             *user_grid);
+      VINA_FOR_IN(i, t.out)
+        t.out[i].conformer = t.conformer;
     }
 };
 
@@ -163,7 +203,8 @@ void merge_output_containers(const output_container& in, output_container& out,
     add_to_output_container(out, in[i], min_rmsd, max_size);
 }
 
-void merge_output_containers(const parallel_mc_task_container& many,
+template<typename Tasks>
+void merge_output_containers(const Tasks& many,
     output_container& out, fl min_rmsd, sz max_size) {
   min_rmsd = 2; // FIXME? perhaps it's necessary to separate min_rmsd during search and during output?
   VINA_FOR_IN(i, many)
@@ -171,17 +212,39 @@ void merge_output_containers(const parallel_mc_task_container& many,
   out.sort();
 }
 
+template<typename Tasks>
+void add_chain_bests(const Tasks& many, output_container* bests) {
+  if (!bests) return;
+  VINA_FOR_IN(i, many)
+    if (!many[i].out.empty())
+      bests->push_back(new output_type(many[i].out.front()));
+}
+
 void parallel_mc::operator()(const model& m, output_container& out,
     const precalculate& p, igrid& ig, const vec& corner1, const vec& corner2,
-    rng& generator, grid& user_grid) const {
+    rng& generator, grid& user_grid, output_container* chain_bests) const {
   parallel_progress pp;
-  parallel_mc_aux parallel_mc_aux_instance(&mc, &p, &ig, &corner1, &corner2,
+  parallel_mc_aux parallel_mc_aux_instance(&mc, &p,
       (display_progress ? (&pp) : NULL), &user_grid);
+  std::vector<search_region> whole_box(1,
+      search_region(&ig, corner1, corner2));
+  const std::vector<search_region>& searched =
+      regions.empty() ? whole_box : regions;
+  if (num_replicas > 1) {
+    replica_exchange(m, out, p, searched, generator, user_grid, chain_bests);
+    return;
+  }
   parallel_mc_task_container task_container;
-  VINA_FOR(i, num_tasks)
-    task_container.push_back(
-        new parallel_mc_task(m, random_int(0, 1000000, generator)));
-  if (display_progress) pp.init(num_tasks * mc.num_steps);
+  //every conformer gets at least one chain; they all share the grids
+  const sz chains = std::max(num_tasks, conformers.size());
+  VINA_FOR_IN(r, searched)
+    VINA_FOR(i, chains) {
+      const sz c = conformers.empty() ? 0 : i % conformers.size();
+      task_container.push_back(
+          new parallel_mc_task(conformers.empty() ? m : *conformers[c],
+              random_int(0, 1000000, generator), &searched[r], c));
+    }
+  if (display_progress) pp.init(task_container.size() * mc.num_steps);
 
   auto thread_init = [&]() {if (m.gdata.device_on) {
       caffe::Caffe::SetDevice(m.gdata.device_id);
@@ -194,6 +257,63 @@ void parallel_mc::operator()(const model& m, output_container& out,
       &parallel_mc_aux_instance, num_threads, thread_init);
   parallel_iter_instance.run(task_container);
 
+  //one rmsd filter over every region, so overlapping regions don't
+  //contribute duplicates
   merge_output_containers(task_container, out, mc.min_rmsd, mc.num_saved_mins);
+  add_chain_bests(task_container, chain_bests);
+
+}
+
+void parallel_mc::replica_exchange(const model& m, output_container& out,
+    const precalculate& p, const std::vector<search_region>& searched,
+    rng& generator, grid& user_grid, output_container* chain_bests) const {
+  parallel_progress pp;
+  replica_aux aux(&mc, &p, (display_progress ? (&pp) : NULL), &user_grid);
+  //about num_tasks chains per region, as without replica exchange
+  const sz ladders = std::max(sz(1), num_tasks / num_replicas);
+  replica_task_container replicas;
+  VINA_FOR_IN(r, searched)
+    VINA_FOR(l, ladders)
+      VINA_FOR(k, num_replicas) {
+        //geometric ladder, so neighbors overlap about equally in energy
+        fl temperature = mc.temperature
+            * std::pow(max_temperature / mc.temperature,
+                fl(k) / (num_replicas - 1));
+        replicas.push_back(
+            new replica_task(m, random_int(0, 1000000, generator),
+                &searched[r], temperature, searched[r].ig->move_receptor()));
+      }
+  if (display_progress) pp.init(replicas.size() * mc.num_steps);
+
+  auto thread_init = []() {};
+  parallel_iter<replica_aux, replica_task_container, replica_task,
+      decltype(thread_init), true> parallel_iter_instance(&aux, num_threads,
+      thread_init);
+  bool odd = false;
+  for (unsigned first = 0; first < mc.num_steps; first += exchange_interval) {
+    aux.first = first;
+    aux.steps = std::min(exchange_interval, mc.num_steps - first);
+    parallel_iter_instance.run(replicas);
+
+    //alternate between even and odd neighbor pairs so a conformation can
+    //move more than one rung per exchange
+    for (sz l = 0; l < replicas.size(); l += num_replicas)
+      for (sz k = l + odd; k + 1 < l + num_replicas; k += 2) {
+        replica_task& cold = replicas[k];
+        replica_task& hot = replicas[k + 1];
+        const fl delta = (1 / cold.temperature - 1 / hot.temperature)
+            * (cold.current.e - hot.current.e);
+        const bool swap = delta >= 0
+            || random_fl(0, 1, generator) < std::exp(delta);
+        if (swap) std::swap(cold.current, hot.current);
+        if (exchanges) {
+          exchanges->tried++;
+          if (swap) exchanges->accepted++;
+        }
+      }
+    odd = !odd;
+  }
 
+  merge_output_containers(replicas, out, mc.min_rmsd, mc.num_saved_mins);
+  add_chain_bests(replicas, chain_bests);
 }
@@ -25,17 +25,61 @@
 
 #include "monte_carlo.h"
 
+//part of the search space with its own grid; chains start between the
+//corners but may move anywhere ig covers
+struct search_region {
+    igrid* ig;
+    vec corner1;
+    vec corner2;
+    search_region(igrid* ig_, const vec& corner1_, const vec& corner2_)
+        : ig(ig_), corner1(corner1_), corner2(corner2_) {
+    }
+};
+
+//neighbor swaps tried and accepted by replica exchange
+struct exchange_stats {
+    sz tried;
+    sz accepted;
+    exchange_stats()
+        : tried(0), accepted(0) {
+    }
+};
+
 struct parallel_mc {
     monte_carlo mc;
     sz num_tasks;
     sz num_threads;
     bool display_progress;
+    //if not empty, num_tasks chains are run in each of these instead of in
+    //the whole box with the ig passed to operator()
+    std::vector<search_region> regions;
+    //replica exchange: with more than one replica, chains are grouped into
+    //ladders of num_replicas temperatures from mc.temperature up to
+    //max_temperature, and neighbors on a ladder try to swap their current
+    //conformations every exchange_interval steps
+    sz num_replicas;
+    fl max_temperature;
+    unsigned exchange_interval;
+    exchange_stats* exchanges; //if not null, replica exchange counts here
+    //rigid conformers of the ligand of the model passed to operator(), all
+    //with the same receptor and atoms; if not empty, chains are dealt out
+    //among them in turn, at least one each, and every output_type records
+    //the conformer it places
+    std::vector<const model*> conformers;
     parallel_mc()
-        : num_tasks(8), num_threads(1), display_progress(true) {
+        : num_tasks(8), num_threads(1), display_progress(true),
+            num_replicas(1), max_temperature(4.8), exchange_interval(10),
+            exchanges(NULL) {
     }
+    //if chain_bests is given, the best pose of every chain is added to it
     void operator()(const model& m, output_container& out,
         const precalculate& p, igrid& ig, const vec& corner1,
-        const vec& corner2, rng& generator, grid& user_grid) const;
+        const vec& corner2, rng& generator, grid& user_grid,
+        output_container* chain_bests = NULL) const;
+  private:
+    void replica_exchange(const model& m, output_container& out,
+        const precalculate& p, const std::vector<search_region>& searched,
+        rng& generator, grid& user_grid, output_container* chain_bests) const;
 };
 
 #endif
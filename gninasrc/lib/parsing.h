@@ -264,7 +264,7 @@ struct pdbqt_initializer {
     model m;
     void initialize_from_rigid(const rigid& r) { // static really
       VINA_CHECK(m.grid_atoms.empty());
-      m.grid_atoms = r.atoms;
+      m.grid_atoms.mutate() = r.atoms;
     }
     void initialize_from_nrp(const non_rigid_parsed& nrp, const context& c,
         bool is_ligand) { // static really
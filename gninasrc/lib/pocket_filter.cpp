@@ -0,0 +1,179 @@
+/*
+ * pocket_filter.cpp
+ *
+ * Free space of the search box and ligand shape descriptors.
+ */
+
+#include <sstream>
+#include <iomanip>
+#include "pocket_filter.h"
+#include "array3d.h"
+
+static const fl spacing = 1.0; //of the lattice, in A
+static const fl margin = 2.0; //ligand atoms at the edge of the box reach past it
+static const fl overlap = 0.5; //close contacts overlap atoms by this much
+
+//mark the points of a lattice at origin with dims points on a side that are
+//within radius of center
+static void stamp(array3d<char>& v, const sz dims[3], const vec& origin,
+    const vec& center, fl radius) {
+  sz lo[3], hi[3];
+  VINA_FOR(d, 3) {
+    const fl a = (center[d] - radius - origin[d]) / spacing;
+    const fl b = (center[d] + radius - origin[d]) / spacing;
+    if (b < 0 || a > fl(dims[d] - 1)) return;
+    lo[d] = a < 0 ? 0 : sz(std::ceil(a));
+    hi[d] = std::min(sz(std::floor(b)), dims[d] - 1);
+  }
+  const fl r2 = radius * radius;
+  VINA_RANGE(k, lo[2], hi[2] + 1)
+    VINA_RANGE(j, lo[1], hi[1] + 1)
+      VINA_RANGE(i, lo[0], hi[0] + 1) {
+        vec p(origin[0] + i * spacing, origin[1] + j * spacing,
+            origin[2] + k * spacing);
+        if ((p - center).norm_sqr() <= r2) v(i, j, k) = 1;
+      }
+}
+
+pocket_filter::pocket_filter(const model& m, const grid_dims& gd)
+    : free_volume(0), free_span(0) {
+  sz dims[3];
+  vec origin;
+  VINA_FOR(d, 3) {
+    origin[d] = gd[d].begin - margin;
+    dims[d] = sz(std::ceil((gd[d].span() + 2 * margin) / spacing)) + 1;
+  }
+  array3d<char> occupied(dims[0], dims[1], dims[2]); //zeroed
+  const atomv& receptor = m.get_fixed_atoms();
+  VINA_FOR_IN(i, receptor) {
+    const atom& a = receptor[i];
+    if (a.is_hydrogen()) continue;
+    stamp(occupied, dims, origin, a.coords, xs_radius(a.get()));
+  }
+
+  //largest region of free points connected through faces
+  array3d<char> seen(occupied);
+  std::vector<sz> stack;
+  VINA_FOR(k, dims[2])
+    VINA_FOR(j, dims[1])
+      VINA_FOR(i, dims[0]) {
+        if (seen(i, j, k)) continue;
+        seen(i, j, k) = 1;
+        sz count = 0;
+        sz lo[3] = { i, j, k }, hi[3] = { i, j, k };
+        stack.push_back(i + dims[0] * (j + dims[1] * k));
+        while (!stack.empty()) {
+          const sz index = stack.back();
+          stack.pop_back();
+          const sz p[3] = { index % dims[0], (index / dims[0]) % dims[1],
+              index / (dims[0] * dims[1]) };
+          count++;
+          VINA_FOR(d, 3) {
+            lo[d] = std::min(lo[d], p[d]);
+            hi[d] = std::max(hi[d], p[d]);
+          }
+          VINA_FOR(d, 3) {
+            sz q[3] = { p[0], p[1], p[2] };
+            if (p[d] > 0) {
+              q[d] = p[d] - 1;
+              if (!seen(q[0], q[1], q[2])) {
+                seen(q[0], q[1], q[2]) = 1;
+                stack.push_back(q[0] + dims[0] * (q[1] + dims[1] * q[2]));
+              }
+            }
+            if (p[d] + 1 < dims[d]) {
+              q[d] = p[d] + 1;
+              if (!seen(q[0], q[1], q[2])) {
+                seen(q[0], q[1], q[2]) = 1;
+                stack.push_back(q[0] + dims[0] * (q[1] + dims[1] * q[2]));
+              }
+            }
+          }
+        }
+        const fl volume = count * spacing * spacing * spacing;
+        if (volume > free_volume) {
+          free_volume = volume;
+          //a point has a whole voxel of room around it
+          vec diagonal(hi[0] - lo[0] + 1, hi[1] - lo[1] + 1,
+              hi[2] - lo[2] + 1);
+          free_span = spacing * std::sqrt(diagonal.norm_sqr());
+        }
+      }
+}
+
+fl pocket_filter::ligand_volume(const model& m) {
+  vec lo(max_fl, max_fl, max_fl), hi(-max_fl, -max_fl, -max_fl);
+  const vecv& coords = m.coordinates();
+  fl radius = 0;
+  VINA_FOR_IN(l, m.ligands) {
+    VINA_RANGE(i, m.ligands[l].begin, m.ligands[l].end) {
+      if (m.atoms[i].is_hydrogen()) continue;
+      VINA_FOR(d, 3) {
+        lo[d] = std::min(lo[d], coords[i][d]);
+        hi[d] = std::max(hi[d], coords[i][d]);
+      }
+      radius = std::max(radius, xs_radius(m.atoms[i].get()) - overlap);
+    }
+  }
+  if (radius == 0) return 0;
+
+  sz dims[3];
+  vec origin;
+  VINA_FOR(d, 3) {
+    origin[d] = lo[d] - radius;
+    dims[d] = sz(std::ceil((hi[d] - lo[d] + 2 * radius) / spacing)) + 1;
+  }
+  array3d<char> occupied(dims[0], dims[1], dims[2]); //zeroed
+  VINA_FOR_IN(l, m.ligands)
+    VINA_RANGE(i, m.ligands[l].begin, m.ligands[l].end)
+      if (!m.atoms[i].is_hydrogen())
+        stamp(occupied, dims, origin, coords[i],
+            xs_radius(m.atoms[i].get()) - overlap);
+  sz count = 0;
+  VINA_FOR(k, dims[2])
+    VINA_FOR(j, dims[1])
+      VINA_FOR(i, dims[0])
+        count += occupied(i, j, k);
+  return count * spacing * spacing * spacing;
+}
+
+//longest heavy atom distance within each rigid piece of the tree t
+template<typename T>
+static void rigid_spans(const T& t, const model& m, fl& longest) {
+  const vecv& coords = m.coordinates();
+  VINA_RANGE(i, t.node.begin, t.node.end) {
+    if (m.atoms[i].is_hydrogen()) continue;
+    VINA_RANGE(j, i + 1, t.node.end) {
+      if (m.atoms[j].is_hydrogen()) continue;
+      longest = std::max(longest,
+          std::sqrt((coords[i] - coords[j]).norm_sqr()));
+    }
+  }
+  VINA_FOR_IN(c, t.children)
+    rigid_spans(t.children[c], m, longest);
+}
+
+fl pocket_filter::rigid_span(const model& m) {
+  fl longest = 0;
+  VINA_FOR_IN(l, m.ligands)
+    rigid_spans(m.ligands[l], m, longest);
+  return longest;
+}
+
+std::string pocket_filter::check(const model& m) const {
+  std::ostringstream why;
+  why << std::fixed << std::setprecision(1);
+  const fl volume = ligand_volume(m);
+  if (volume > free_volume) {
+    why << "ligand volume " << volume << " A^3 exceeds the " << free_volume
+        << " A^3 of free space in the box";
+    return why.str();
+  }
+  const fl span = rigid_span(m);
+  if (span > free_span) {
+    why << "a rigid fragment spans " << span
+        << " A but the free space in the box spans " << free_span << " A";
+    return why.str();
+  }
+  return "";
+}
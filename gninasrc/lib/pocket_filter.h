@@ -0,0 +1,46 @@
+/*
+ * pocket_filter.h
+ *
+ * Cheap shape test to skip ligands that can not fit in the search box.  The
+ * space of the box (plus a small margin) not covered by receptor heavy atoms
+ * is found once on a 1A lattice, and its largest connected region gives a
+ * free volume and a longest span.  A ligand fails if its heavy atoms take up
+ * more volume than that, or if one of its rigid fragments is longer than the
+ * span, since no choice of torsions can fold a rigid fragment.  Both tests
+ * overestimate the room the ligand has, so only ligands that clearly can not
+ * bind are caught.
+ */
+
+#ifndef POCKET_FILTER_H_
+#define POCKET_FILTER_H_
+
+#include <string>
+#include "grid_dim.h"
+#include "model.h"
+
+class pocket_filter {
+    fl free_volume; //of the largest connected empty region, in A^3
+    fl free_span; //bounding box diagonal of that region, in A
+
+  public:
+    //m supplies the receptor atoms; its ligand is ignored
+    pocket_filter(const model& m, const grid_dims& gd);
+
+    fl volume() const {
+      return free_volume;
+    }
+    fl span() const {
+      return free_span;
+    }
+
+    //volume of the ligand heavy atoms of m, on the same lattice, with radii
+    //shrunk to allow for close contacts
+    static fl ligand_volume(const model& m);
+    //longest distance between heavy atoms of one rigid fragment of m
+    static fl rigid_span(const model& m);
+
+    //why the ligand of m can not fit in the box, empty if it might
+    std::string check(const model& m) const;
+};
+
+#endif /* POCKET_FILTER_H_ */
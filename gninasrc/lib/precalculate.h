@@ -51,6 +51,9 @@ class precalculate {
 
     }
 
+    fl cutoff() const {
+      return m_cutoff;
+    }
     fl cutoff_sqr() const {
       return m_cutoff_sqr;
     }
@@ -24,6 +24,7 @@
 #include "cache_gpu.h"
 #include "quasi_newton.h"
 #include "bfgs.h"
+#include "lbfgs.h"
 #include "device_buffer.h"
 
 struct quasi_newton_aux {
@@ -57,6 +58,9 @@ void quasi_newton::operator()(model& m, const precalculate& p, igrid& ig,
       std::cerr << "usergrid not supported in gpu code yet\n";
       exit(-1);
     }
+    //there is no gpu L-BFGS, main rejects --lbfgs with --gpu
+    assert(params.type != minimization_params::LBFGSFastLineSearch
+        && params.type != minimization_params::LBFGSAccurateLineSearch);
     change_gpu gchange(g, m.gdata, thread_buffer);
     conf_gpu gconf(out.c, m.gdata, thread_buffer);
     fl res;
@@ -76,6 +80,9 @@ void quasi_newton::operator()(model& m, const precalculate& p, igrid& ig,
     if (params.type == minimization_params::Simple)
       res = simple_gradient_ascent(aux, out.c, g, average_required_improvement,
           params);
+    else if (params.type == minimization_params::LBFGSFastLineSearch
+        || params.type == minimization_params::LBFGSAccurateLineSearch)
+      res = lbfgs(aux, out.c, g, average_required_improvement, params);
     else
       res = bfgs(aux, out.c, g, average_required_improvement, params);
     out.e = res;
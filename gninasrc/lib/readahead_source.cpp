@@ -0,0 +1,175 @@
+/*
+ * readahead_source.cpp
+ *
+ * Background reader behind readahead_source.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <boost/bind.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include "readahead_source.h"
+#ifndef WIN32
+#include <fcntl.h>
+#endif
+
+//unbuffered reads of the raw file, chunk_size at a time
+class raw_file_source {
+    FILE* file;
+  public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    explicit raw_file_source(FILE* f)
+        : file(f) {
+    }
+
+    std::streamsize read(char* s, std::streamsize n) {
+      std::streamsize got = std::fread(s, 1, n, file);
+      if (got == 0 && (std::feof(file) || std::ferror(file))) return -1;
+      return got;
+    }
+};
+
+class readahead_buffer {
+    FILE* file;
+    bool gzipped;
+    std::streamsize chunk_size;
+    unsigned depth;
+
+    std::deque<std::string> chunks; //read ahead, in order
+    bool eof; //no chunks after these
+    boost::exception_ptr error; //from reading or decompressing
+    bool stopping;
+    boost::mutex mutex;
+    boost::condition_variable filled;
+    boost::condition_variable emptied;
+    boost::thread reader;
+
+    std::string current; //being consumed
+    std::streamsize offset;
+
+    //queue chunk once there is room, return false if we are stopping
+    bool hand_over(std::string& chunk, bool last,
+        boost::exception_ptr err = boost::exception_ptr()) {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      while (chunks.size() >= depth && !stopping)
+        emptied.wait(lock);
+      if (stopping) return false;
+      if (chunk.size() > 0) {
+        chunks.push_back(std::string());
+        chunks.back().swap(chunk);
+      }
+      error = err;
+      eof = last;
+      filled.notify_all();
+      return true;
+    }
+
+    void read_ahead() {
+      std::string chunk;
+      try {
+        //the gzip filter keeps its default buffer, so that no more than
+        //before is lost when a truncated or corrupt file fails to inflate
+        boost::iostreams::filtering_istream in;
+        if (gzipped) in.push(boost::iostreams::gzip_decompressor());
+        in.push(raw_file_source(file), chunk_size);
+        std::streambuf& buf = *in.rdbuf();
+        bool more = true;
+        while (more) {
+          chunk.reserve(chunk_size);
+          while (chunk.size() < std::string::size_type(chunk_size)) {
+            //only copy what is already decompressed; if decompressing
+            //more throws, everything before the error is still handed over
+            if (buf.sgetc() == std::char_traits<char>::eof()) {
+              more = false;
+              break;
+            }
+            std::streamsize amt = std::min(buf.in_avail(),
+                chunk_size - std::streamsize(chunk.size()));
+            std::string::size_type end = chunk.size();
+            chunk.resize(end + amt);
+            buf.sgetn(&chunk[end], amt);
+          }
+          if (!hand_over(chunk, !more)) return;
+        }
+      } catch (...) {
+        hand_over(chunk, true, boost::current_exception());
+      }
+    }
+
+  public:
+    readahead_buffer(const std::string& name, bool gzipped_,
+        std::streamsize chunk_size_, unsigned depth_)
+        : file(std::fopen(name.c_str(), "rb")), gzipped(gzipped_),
+            chunk_size(chunk_size_), depth(std::max(depth_, 1u)), eof(false),
+            stopping(false), offset(0) {
+      if (!file) return;
+      std::setvbuf(file, NULL, _IONBF, 0); //reads are already large
+#if !defined(WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+      //let the kernel read further ahead too
+      posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      reader = boost::thread(boost::bind(&readahead_buffer::read_ahead, this));
+    }
+
+    ~readahead_buffer() {
+      {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        stopping = true;
+      }
+      emptied.notify_all();
+      if (reader.joinable()) reader.join();
+      if (file) std::fclose(file);
+    }
+
+    bool is_open() const {
+      return file != NULL;
+    }
+
+    std::streamsize read(char* s, std::streamsize n) {
+      std::streamsize done = 0;
+      while (done < n) {
+        if (offset == std::streamsize(current.size())) {
+          boost::unique_lock<boost::mutex> lock(mutex);
+          while (chunks.empty() && !eof)
+            filled.wait(lock);
+          if (chunks.empty()) {
+            //pass on a decompression error once the good data is used up
+            if (error && done == 0) boost::rethrow_exception(error);
+            break;
+          }
+          current.swap(chunks.front());
+          chunks.pop_front();
+          offset = 0;
+          emptied.notify_all();
+        }
+        std::streamsize amt = std::min(n - done,
+            std::streamsize(current.size()) - offset);
+        std::copy(current.data() + offset, current.data() + offset + amt,
+            s + done);
+        offset += amt;
+        done += amt;
+      }
+      return done == 0 && n > 0 ? -1 : done;
+    }
+};
+
+readahead_source::readahead_source(const std::string& name, bool gzipped,
+    std::streamsize chunk_size, unsigned depth)
+    : buffer(new readahead_buffer(name, gzipped, chunk_size, depth)) {
+}
+
+bool readahead_source::is_open() const {
+  return buffer->is_open();
+}
+
+std::streamsize readahead_source::read(char* s, std::streamsize n) {
+  return buffer->read(s, n);
+}
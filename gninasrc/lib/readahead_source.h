@@ -0,0 +1,39 @@
+/*
+ * readahead_source.h
+ *
+ * Input device that reads, and if need be gunzips, a file on a background
+ * thread.  Large reads are issued ahead of the parser and the decompressed
+ * data is handed over in chunks through a short queue, so on a slow or
+ * remote filesystem the parser rarely waits on I/O and decompression
+ * overlaps parsing.
+ */
+
+#ifndef READAHEAD_SOURCE_H_
+#define READAHEAD_SOURCE_H_
+
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/iostreams/categories.hpp>
+
+class readahead_buffer;
+
+class readahead_source {
+  public:
+    typedef char char_type;
+    typedef boost::iostreams::source_tag category;
+
+    //chunk_size bytes of decompressed data are handed over at a time, with
+    //up to depth chunks read ahead
+    readahead_source(const std::string& name, bool gzipped,
+        std::streamsize chunk_size = 1 << 20, unsigned depth = 4);
+
+    //false if the file could not be opened
+    bool is_open() const;
+
+    std::streamsize read(char* s, std::streamsize n);
+
+  private:
+    boost::shared_ptr<readahead_buffer> buffer; //shared by copies
+};
+
+#endif /* READAHEAD_SOURCE_H_ */
@@ -0,0 +1,102 @@
+/*
+ * receptor_index.cpp
+ */
+
+#include "receptor_index.h"
+#include <algorithm>
+#include <cmath>
+
+//padding on the cell size so rounding in cell_of never separates atoms
+//closer than the cutoff by more than one cell
+#define RECEPTOR_INDEX_SLACK 1.01
+
+receptor_index::receptor_index(const atomv& grid_atoms, fl cutoff_)
+    : cutoff(cutoff_), grid_atoms_data(grid_atoms.data()),
+        num_grid_atoms(grid_atoms.size()),
+        coords_hash(hash_coords(grid_atoms)),
+        cell_size(std::max(cutoff_, fl(1.0)) * RECEPTOR_INDEX_SLACK) {
+  sz n = num_atom_types();
+  szv indexed;
+  vec lo(0, 0, 0), hi(0, 0, 0);
+  VINA_FOR_IN(i, grid_atoms) {
+    smt t = grid_atoms[i].get();
+    if (t >= n || is_hydrogen(t)) continue;
+    const vec& c = grid_atoms[i].coords;
+    VINA_FOR(d, 3) {
+      if (indexed.empty() || c[d] < lo[d]) lo[d] = c[d];
+      if (indexed.empty() || c[d] > hi[d]) hi[d] = c[d];
+    }
+    indexed.push_back(i);
+  }
+
+  origin = lo;
+  VINA_FOR(d, 3) {
+    dims[d] = int(std::floor((hi[d] - lo[d]) / cell_size)) + 1;
+  }
+
+  //counting sort by cell, stable so every cell stays in ascending order
+  sz ncells = sz(dims[0]) * dims[1] * dims[2];
+  std::vector<unsigned> cell(indexed.size());
+  cell_start.assign(ncells + 1, 0);
+  VINA_FOR_IN(k, indexed) {
+    const vec& c = grid_atoms[indexed[k]].coords;
+    cell[k] = (cell_of(c[0], 0) * dims[1] + cell_of(c[1], 1)) * dims[2]
+        + cell_of(c[2], 2);
+    cell_start[cell[k] + 1]++;
+  }
+  VINA_FOR(c, ncells)
+    cell_start[c + 1] += cell_start[c];
+
+  cell_atoms.resize(indexed.size());
+  std::vector<unsigned> fill(cell_start.begin(), cell_start.end() - 1);
+  VINA_FOR_IN(k, indexed)
+    cell_atoms[fill[cell[k]]++] = indexed[k];
+}
+
+//FNV-1a over the raw coordinates and types
+unsigned long receptor_index::hash_coords(const atomv& grid_atoms) {
+  unsigned long h = 14695981039346656037UL;
+  VINA_FOR_IN(i, grid_atoms) {
+    const atom& a = grid_atoms[i];
+    smt t = a.get();
+    const unsigned char* bytes[2] = {
+        reinterpret_cast<const unsigned char*>(a.coords.data),
+        reinterpret_cast<const unsigned char*>(&t) };
+    const sz sizes[2] = { sizeof(a.coords.data), sizeof(t) };
+    VINA_FOR(k, 2)
+      VINA_FOR(b, sizes[k]) {
+        h ^= bytes[k][b];
+        h *= 1099511628211UL;
+      }
+  }
+  return h;
+}
+
+//unclamped cell coordinate of x along dim
+int receptor_index::cell_of(fl x, sz dim) const {
+  fl c = std::floor((x - origin[dim]) / cell_size);
+  //keep far away points from overflowing, anything outside is equivalent
+  if (c < -2) return -2;
+  if (c > dims[dim] + 1) return dims[dim] + 1;
+  return int(c);
+}
+
+void receptor_index::candidates(const vec& p, szv& out) const {
+  out.clear();
+  int lo[3], hi[3];
+  VINA_FOR(d, 3) {
+    int c = cell_of(p[d], d);
+    lo[d] = std::max(c - 1, 0);
+    hi[d] = std::min(c + 1, dims[d] - 1);
+    if (lo[d] > hi[d]) return;
+  }
+
+  for (int x = lo[0]; x <= hi[0]; x++) {
+    for (int y = lo[1]; y <= hi[1]; y++) {
+      unsigned row = (x * dims[1] + y) * dims[2];
+      out.insert(out.end(), cell_atoms.begin() + cell_start[row + lo[2]],
+          cell_atoms.begin() + cell_start[row + hi[2] + 1]);
+    }
+  }
+  std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,55 @@
+/*
+ * receptor_index.h
+ *
+ * Cell list over the receptor (grid) atoms of a model for exact, non-grid
+ * scoring.  Only heavy atoms with a valid type are indexed since those are
+ * the only ones that contribute.  Cells are slightly larger than the cutoff,
+ * so every receptor atom within the cutoff of a point is in the 3x3x3 block
+ * of cells around that point's cell.
+ */
+
+#ifndef RECEPTOR_INDEX_H_
+#define RECEPTOR_INDEX_H_
+
+#include <vector>
+#include "atom.h"
+
+class receptor_index {
+    fl cutoff;
+    const atom* grid_atoms_data; //buffer of grid_atoms when built
+    sz num_grid_atoms; //size of grid_atoms when built
+    unsigned long coords_hash; //of the coordinates and types when built
+    fl cell_size;
+    vec origin;
+    int dims[3];
+    std::vector<unsigned> cell_start; //offsets into cell_atoms, one per cell plus end
+    std::vector<unsigned> cell_atoms; //ascending grid atom indices, by cell
+
+    int cell_of(fl x, sz dim) const;
+
+  public:
+    receptor_index(const atomv& grid_atoms, fl cutoff_);
+
+    //true if this index was built for this atom buffer with this cutoff;
+    //the buffer's contents are assumed unchanged, check_coords verifies that
+    bool matches(const atomv& grid_atoms, fl cutoff_) const {
+      return grid_atoms_data == grid_atoms.data()
+          && num_grid_atoms == grid_atoms.size() && cutoff == cutoff_;
+    }
+
+    //true if grid_atoms have the coordinates and types this index was built
+    //from; linear in the number of atoms, so meant for assertions
+    bool check_coords(const atomv& grid_atoms) const {
+      return num_grid_atoms == grid_atoms.size()
+          && coords_hash == hash_coords(grid_atoms);
+    }
+
+    static unsigned long hash_coords(const atomv& grid_atoms);
+
+    //set out to the indices of every indexed receptor atom that may be
+    //within the cutoff of p, in ascending order so that summing over them
+    //gives the same result as looping over all of grid_atoms
+    void candidates(const vec& p, szv& out) const;
+};
+
+#endif /* RECEPTOR_INDEX_H_ */
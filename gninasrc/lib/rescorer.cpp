@@ -0,0 +1,108 @@
+/*
+ * rescorer.cpp
+ *
+ * Batch rescoring of pre-posed ligands, see rescorer.h.
+ */
+
+#include "rescorer.h"
+#include "naive_non_cache.h"
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/algorithm/string.hpp>
+
+//poses read and scored per thread per batch, bounds memory use
+#define RESCORE_POSES_PER_THREAD 64
+
+BatchRescorer::BatchRescorer(const weighted_terms& wt_, fl forcecap,
+    unsigned nthreads_, bool print_terms_)
+    : wt(wt_), prec(wt_), authentic_v(forcecap, forcecap, forcecap),
+        nthreads(nthreads_ > 0 ? nthreads_ : 1), print_terms(print_terms_) {
+}
+
+//same computation as do_search with --score_only
+void BatchRescorer::score_poses(unsigned start, std::vector<model>& poses,
+    unsigned n, std::vector<pose_score>& out) const {
+  const terms *t = wt.unweighted_terms();
+  const flv nonweight(1, 1.0);
+  naive_non_cache nnc(&prec);
+  for (unsigned i = start; i < n; i += nthreads) {
+    model& m = poses[i];
+    pose_score& s = out[i];
+    conf c = m.get_initial_conf(false);
+    s.name = m.get_name();
+    s.intramolecular = m.eval_intramolecular(prec, authentic_v, c);
+    s.affinity = m.eval_adjusted(wt, prec, nnc, authentic_v, c,
+        s.intramolecular, user_grid);
+
+    s.terms.clear();
+    if (print_terms) {
+      s.terms = t->evale_robust(m);
+      conf_independent_inputs in(m);
+      for (unsigned j = 0, nt = t->conf_independent_terms.size(); j < nt;
+          j++) {
+        flv::const_iterator pos = nonweight.begin();
+        s.terms.push_back(t->conf_independent_terms[j].eval(in, (fl) 0.0, pos));
+      }
+    }
+  }
+}
+
+void BatchRescorer::score(std::vector<model>& poses, unsigned n,
+    std::vector<pose_score>& out) const {
+  out.resize(n);
+  boost::thread_group threads;
+  for (unsigned t = 0; t < nthreads && t < n; t++) {
+    threads.create_thread(
+        boost::bind(&BatchRescorer::score_poses, this, t, boost::ref(poses), n,
+            boost::ref(out)));
+  }
+  threads.join_all();
+}
+
+void BatchRescorer::write_header(tee& log) const {
+  log << "## Name Affinity Intramolecular";
+  if (print_terms) {
+    const terms *t = wt.unweighted_terms();
+    std::vector<std::string> names = t->get_names(true);
+    VINA_FOR_IN(i, names)
+      log << " " << names[i];
+    for (unsigned i = 0, n = t->conf_independent_terms.size(); i < n; i++)
+      log << " " << t->conf_independent_terms[i].name;
+  }
+  log << "\n";
+}
+
+void BatchRescorer::write(const pose_score& s, tee& log) const {
+  log << boost::replace_all_copy(s.name, " ", "_") << " " << std::fixed
+      << std::setprecision(5) << s.affinity << " " << s.intramolecular;
+  VINA_FOR_IN(i, s.terms)
+    log << " " << s.terms[i];
+  log << "\n";
+}
+
+size_t BatchRescorer::run(MolGetter& mols,
+    const std::vector<std::string>& ligand_names, tee& log) const {
+  //build before the worker threads would wait on it
+  mols.getInitModel().get_grid_index(prec.cutoff());
+  write_header(log);
+
+  unsigned batch = nthreads * RESCORE_POSES_PER_THREAD;
+  std::vector<model> poses(batch);
+  std::vector<pose_score> scores;
+  size_t total = 0;
+  VINA_FOR_IN(l, ligand_names) {
+    mols.setInputFile(ligand_names[l]);
+    unsigned n = batch;
+    while (n == batch) {
+      //reading is not thread safe
+      n = 0;
+      while (n < batch && mols.readMoleculeIntoModel(poses[n]))
+        n++;
+      score(poses, n, scores);
+      for (unsigned i = 0; i < n; i++)
+        write(scores[i], log);
+      total += n;
+    }
+  }
+  return total;
+}
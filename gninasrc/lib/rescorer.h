@@ -0,0 +1,58 @@
+/*
+ * rescorer.h
+ *
+ * Fast --score_only for large numbers of pre-posed ligands against a single
+ * receptor.  The receptor neighbor index is built once and shared by every
+ * pose, poses are read a batch at a time, scored on all threads with the
+ * same exact evaluation --score_only uses, and reported in input order as
+ * one line per pose.
+ */
+
+#ifndef RESCORER_H_
+#define RESCORER_H_
+
+#include <vector>
+#include <string>
+#include "molgetter.h"
+#include "weighted_terms.h"
+#include "precalculate.h"
+#include "grid.h"
+#include "tee.h"
+
+class BatchRescorer {
+  public:
+    struct pose_score {
+        std::string name;
+        fl affinity;
+        fl intramolecular;
+        flv terms; //unweighted, then conf independent; only if requested
+    };
+
+  private:
+    const weighted_terms& wt;
+    precalculate_exact prec;
+    grid user_grid; //never initialized, eval_adjusted requires one
+    vec authentic_v;
+    unsigned nthreads;
+    bool print_terms;
+
+    void score_poses(unsigned start, std::vector<model>& poses, unsigned n,
+        std::vector<pose_score>& out) const;
+
+  public:
+    BatchRescorer(const weighted_terms& wt_, fl forcecap, unsigned nthreads_,
+        bool print_terms_);
+
+    //score the first n poses in parallel, out[i] is the score of poses[i]
+    void score(std::vector<model>& poses, unsigned n,
+        std::vector<pose_score>& out) const;
+
+    void write_header(tee& log) const;
+    void write(const pose_score& s, tee& log) const;
+
+    //score every molecule of every ligand file, return number of poses
+    size_t run(MolGetter& mols, const std::vector<std::string>& ligand_names,
+        tee& log) const;
+};
+
+#endif /* RESCORER_H_ */
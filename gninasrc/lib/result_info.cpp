@@ -119,8 +119,15 @@ void result_info::write(std::ostream& out, std::string& ext,
   if (sdfvalid && strcmp(format->GetID(), "sdf") == 0) { //use native sdf
     out << molstr;
     //now sd data
-    out << "> <minimizedAffinity>\n";
-    out << std::fixed << std::setprecision(5) << energy << "\n\n";
+    if (hasenergy) {
+      out << "> <minimizedAffinity>\n";
+      out << std::fixed << std::setprecision(5) << energy << "\n\n";
+    }
+
+    if (note.size() > 0) {
+      out << "> <prefilter>\n";
+      out << note << "\n\n";
+    }
 
     if (rmsd >= 0) {
       out << "> <minimizedRMSD>\n";
@@ -148,8 +155,10 @@ void result_info::write(std::ostream& out, std::string& ext,
   } else
     if (!sdfvalid && ext == ".pdbqt") {
       out << "MODEL " << boost::lexical_cast<std::string>(modelnum) << "\n";
-      out << "REMARK minimizedAffinity "
-          << boost::lexical_cast<std::string>((float) energy);
+      if (note.size() > 0) out << "REMARK prefilter " << note << "\n";
+      if (hasenergy)
+        out << "REMARK minimizedAffinity "
+            << boost::lexical_cast<std::string>((float) energy);
       if (rmsd >= 0)
         out << "REMARK minimizedRMSD "
             << boost::lexical_cast<std::string>((float) rmsd);
@@ -172,8 +181,10 @@ void result_info::write(std::ostream& out, std::string& ext,
       outconv.ReadString(&mol, molstr); //otherwise keep orig mol
       mol.DeleteData(OBGenericDataType::PairData); //remove remarks
 
-      setMolData(format, mol, "minimizedAffinity",
-          boost::lexical_cast<std::string>((float) energy));
+      if (hasenergy)
+        setMolData(format, mol, "minimizedAffinity",
+            boost::lexical_cast<std::string>((float) energy));
+      if (note.size() > 0) setMolData(format, mol, "prefilter", note);
 
       if (rmsd >= 0) {
         setMolData(format, mol, "minimizedRMSD",
@@ -25,16 +25,30 @@ class result_info {
     std::string flexstr;
     std::string atominfo;
     std::string name;
+    std::string note; //why the ligand was not docked as usual, if it wasn't
     bool sdfvalid;
+    bool hasenergy;
 
   public:
     result_info()
-        : energy(0), cnnscore(-1), cnnaffinity(0), rmsd(-1), sdfvalid(false) {
+        : energy(0), cnnscore(-1), cnnaffinity(0), rmsd(-1), sdfvalid(false),
+            hasenergy(true) {
     }
     result_info(fl e, fl c, fl ca, fl g, fl r, const model& m)
-        : energy(e), cnnscore(c), cnnaffinity(ca), rmsd(r), sdfvalid(false) {
+        : energy(e), cnnscore(c), cnnaffinity(ca), rmsd(r), sdfvalid(false),
+            hasenergy(true) {
       setMolecule(m);
     }
+    //a ligand that was not docked, output as given with the reason
+    result_info(const std::string& note_, const model& m)
+        : energy(0), cnnscore(-1), cnnaffinity(0), rmsd(-1), note(note_),
+            sdfvalid(false), hasenergy(false) {
+      setMolecule(m);
+    }
+
+    void setNote(const std::string& n) {
+      note = n;
+    }
 
     //set the molecular data using the current conformation of model m
     void setMolecule(const model& m);
@@ -0,0 +1,89 @@
+/*
+ * search_budget.cpp
+ *
+ * Per ligand chains and steps for a screen with a CPU time budget.
+ */
+
+#include "search_budget.h"
+
+//weight of the newest ligand in the seconds per unit estimate
+static const fl calibration_weight = 0.3;
+
+search_budget::search_budget(fl total_seconds, fl ligands_per_hour,
+    sz cpus_)
+    : total(total_seconds), per_ligand(3600 * cpus_ / ligands_per_hour),
+        cpus(std::max(cpus_, sz(1))), spent(0), ligands(0),
+        seconds_per_unit(0), bank(0) {
+}
+
+fl search_budget::step_cost(const model& m) {
+  //minimizer evaluations per step, as in main_procedure, times the work of
+  //an evaluation: grid lookups for each atom, internal pairs, and the tree
+  //traversal over the degrees of freedom
+  const fl evals = fl((25 + m.num_movable_atoms()) / 3);
+  return evals
+      * (m.num_movable_atoms() + m.num_internal_pairs()
+          + m.get_size().num_degrees_of_freedom());
+}
+
+search_budget::allotment search_budget::assign(const model& m,
+    sz default_chains, unsigned default_steps) {
+  allotment a;
+  a.chains = default_chains;
+  a.steps = default_steps;
+  a.step_cost = step_cost(m);
+
+  //this ligand's share at the target rate, less some of anything overspent,
+  //but no more than is left of the total
+  fl target = per_ligand;
+  if (bank < 0) target = std::max(target / 4, target + bank);
+  if (total > 0) target = std::min(target, std::max(fl(0), total - spent));
+  a.seconds = target;
+
+  if (seconds_per_unit > 0) {
+    const fl scale = target
+        / (seconds_per_unit * a.step_cost * default_chains * default_steps);
+    //change the number of chains first, keeping every cpu busy, then the
+    //length of the chains
+    const sz min_chains = std::min(default_chains, cpus);
+    const sz max_chains = 4 * default_chains;
+    fl chains = std::floor(default_chains * scale + 0.5);
+    a.chains = sz(std::min(fl(max_chains), std::max(fl(min_chains), chains)));
+    const fl steps = default_steps * (default_chains * scale / a.chains);
+    const fl min_steps = std::max(1u, default_steps / 8);
+    const fl max_steps = 4.0 * default_steps;
+    a.steps = unsigned(std::min(max_steps, std::max(min_steps, steps)));
+  }
+  a.units = a.chains * fl(a.steps) * a.step_cost;
+  return a;
+}
+
+sz search_budget::extend(allotment& a) {
+  if (seconds_per_unit <= 0 || bank <= 0 || a.steps == 0) return 0;
+  const fl chain_seconds = seconds_per_unit * a.step_cost * a.steps;
+  //half as many chains again, if the bank has that much
+  sz chains = std::max(cpus, a.chains / 2);
+  chains = std::min(chains, sz(bank / chain_seconds));
+  if (chains == 0) return 0;
+
+  const fl seconds = chains * chain_seconds;
+  bank -= seconds;
+  a.seconds += seconds;
+  a.units += chains * fl(a.steps) * a.step_cost;
+  return chains;
+}
+
+void search_budget::record(const allotment& a, fl cpu_seconds) {
+  spent += cpu_seconds;
+  ligands++;
+  if (a.units > 0) {
+    const fl measured = cpu_seconds / a.units;
+    if (seconds_per_unit <= 0)
+      seconds_per_unit = measured;
+    else
+      seconds_per_unit = (1 - calibration_weight) * seconds_per_unit
+          + calibration_weight * measured;
+  }
+  if (a.seconds > 0) bank += a.seconds - cpu_seconds;
+  if (total > 0) bank = std::min(bank, total - spent);
+}
@@ -0,0 +1,68 @@
+/*
+ * search_budget.h
+ *
+ * Chooses how many monte carlo chains and steps each ligand of a screen gets
+ * so the screen as a whole keeps to a CPU time budget.  The cost of a ligand
+ * is estimated from its size in arbitrary units and the CPU seconds per unit
+ * are measured on the ligands docked so far, so the first ligand always runs
+ * with the usual settings.  Time saved by ligands that finish under their
+ * allotment is banked and spent on more chains for ligands whose best pose
+ * was not found by more than one chain.
+ *
+ * Ligands are docked one at a time, so this is not thread safe.
+ */
+
+#ifndef SEARCH_BUDGET_H_
+#define SEARCH_BUDGET_H_
+
+#include "model.h"
+
+class search_budget {
+  public:
+    struct allotment {
+        sz chains;
+        unsigned steps;
+        fl step_cost; //units per step of one chain
+        fl seconds; //CPU seconds allotted, 0 before calibration
+        fl units; //work done, including any extensions
+        allotment()
+            : chains(0), steps(0), step_cost(0), seconds(0), units(0) {
+        }
+    };
+
+  private:
+    fl total; //CPU seconds for the screen, 0 for no limit
+    fl per_ligand; //CPU seconds per ligand at the target rate
+    sz cpus;
+    fl spent;
+    sz ligands;
+    fl seconds_per_unit; //0 until the first ligand is recorded
+    fl bank; //saved (positive) or overspent (negative) seconds
+
+  public:
+    //ligands_per_hour is the target wall clock rate when docking on cpus
+    //threads; total_seconds optionally caps the CPU time of the whole
+    //screen, after which ligands get the smallest search (0 for no cap)
+    search_budget(fl total_seconds, fl ligands_per_hour, sz cpus_);
+
+    //estimated work of one monte carlo step of m
+    static fl step_cost(const model& m);
+
+    //chains and steps for the next ligand, scaled from the defaults
+    allotment assign(const model& m, sz default_chains,
+        unsigned default_steps);
+
+    //number of additional chains of a.steps steps that the bank can pay for,
+    //0 if none; a is charged for them
+    sz extend(allotment& a);
+
+    //a ligand docked with a took cpu_seconds in all, i.e. its wall clock
+    //time on all cpus threads
+    void record(const allotment& a, fl cpu_seconds);
+
+    fl seconds_spent() const {
+      return spent;
+    }
+};
+
+#endif /* SEARCH_BUDGET_H_ */
@@ -0,0 +1,25 @@
+/*
+ * shared_receptor.cpp
+ *
+ * Copy on write receptor atoms shared by model copies.
+ */
+
+#include "shared_receptor.h"
+
+atomv& shared_receptor::mutate() {
+  if (data.unique()) {
+    boost::mutex::scoped_lock lock(data->index_lock);
+    data->index.reset();
+  } else
+    data.reset(new block(data->atoms));
+  return data->atoms;
+}
+
+boost::shared_ptr<const receptor_index> shared_receptor::index(
+    fl cutoff) const {
+  boost::mutex::scoped_lock lock(data->index_lock);
+  if (!data->index || !data->index->matches(data->atoms, cutoff))
+    data->index.reset(new receptor_index(data->atoms, cutoff));
+  assert(data->index->check_coords(data->atoms));
+  return data->index;
+}
@@ -0,0 +1,92 @@
+/*
+ * shared_receptor.h
+ *
+ * The grid (receptor) atoms of a model.  Models are copied for every ligand,
+ * every monte carlo task and every output pose, but the receptor does not
+ * change once it is set up, so the atoms, along with their spatial index, are
+ * kept in a reference counted block that all copies share.  Anything that
+ * needs to change them calls mutate(), which first gives this model its own
+ * copy if the block is shared.  Appending a ligand to a model with flexible
+ * residues is such a change when receptor atoms are bonded to the inflex
+ * atoms (see model::append), so those models each get a full copy.
+ */
+
+#ifndef SHARED_RECEPTOR_H_
+#define SHARED_RECEPTOR_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/serialization/split_member.hpp>
+#include <boost/serialization/vector.hpp>
+#include "atom.h"
+#include "receptor_index.h"
+
+class shared_receptor {
+    struct block {
+        atomv atoms;
+        //built on first use, guarded by index_lock since the block is shared
+        //across threads
+        boost::shared_ptr<const receptor_index> index;
+        boost::mutex index_lock;
+
+        block() {
+        }
+        block(const atomv& a)
+            : atoms(a) {
+        }
+    };
+    boost::shared_ptr<block> data;
+
+    friend class boost::serialization::access;
+    template<class Archive>
+    void save(Archive& ar, const unsigned version) const {
+      ar & data->atoms;
+      //atom serialization omits bonds
+      VINA_FOR_IN(i, data->atoms)
+        ar & data->atoms[i].bonds;
+    }
+    template<class Archive>
+    void load(Archive& ar, const unsigned version) {
+      atomv& atoms = mutate();
+      ar & atoms;
+      VINA_FOR_IN(i, atoms)
+        ar & atoms[i].bonds;
+    }
+    BOOST_SERIALIZATION_SPLIT_MEMBER()
+
+  public:
+    typedef atomv::const_iterator const_iterator;
+
+    shared_receptor()
+        : data(new block) {
+    }
+
+    sz size() const {
+      return data->atoms.size();
+    }
+    bool empty() const {
+      return data->atoms.empty();
+    }
+    const atom& operator[](sz i) const {
+      return data->atoms[i];
+    }
+    const_iterator begin() const {
+      return data->atoms.begin();
+    }
+    const_iterator end() const {
+      return data->atoms.end();
+    }
+    const atomv& get() const {
+      return data->atoms;
+    }
+
+    //writable atoms, copied first if shared; invalidates the index
+    atomv& mutate();
+
+    //spatial index of the atoms, built once per cutoff and shared; callers
+    //hold the returned pointer, since another thread may replace the index
+    //with one for a different cutoff
+    boost::shared_ptr<const receptor_index> index(fl cutoff) const;
+};
+
+#endif /* SHARED_RECEPTOR_H_ */
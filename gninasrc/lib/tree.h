@@ -249,6 +249,7 @@ struct segment : public axis_frame {
     }
   private:
     friend struct segment_node;
+    friend class flat_tree;
 
     vec relative_axis;
     vec relative_origin;
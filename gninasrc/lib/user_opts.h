@@ -9,6 +9,7 @@ struct cnn_options {
     std::string cnn_recmap; //optional file specifying receptor atom typing to channel map
     std::string cnn_ligmap; //optional file specifying ligand atom typing to channel map
     std::string cnn_model_name; // name of builtin model
+    std::string cnn_precision; //fp32 or int8 for CPU convolutions
     vec cnn_center;
     fl resolution; //this isn't specified in model file, so be careful about straying from default
     unsigned cnn_rotations; //do we want to score multiple orientations?
@@ -23,12 +24,13 @@ struct cnn_options {
     bool verbose;
     std::string xyzprefix;
     unsigned seed; //random seed
+    unsigned cpu_threads; //threads CPU convolutions may use in each scoring call
 
     cnn_options()
-        : cnn_model_name("default2017"), cnn_center(NAN, NAN, NAN), resolution(0.5), cnn_rotations(0),
+        : cnn_model_name("default2017"), cnn_precision("fp32"), cnn_center(NAN, NAN, NAN), resolution(0.5), cnn_rotations(0),
             subgrid_dim(0.0), cnn_scoring(false), cnn_refinement(false), outputdx(false),
             outputxyz(false), gradient_check(false), move_minimize_frame(false),
-            fix_receptor(false), verbose(false), seed(0) {
+            fix_receptor(false), verbose(false), seed(0), cpu_threads(1) {
     }
 
     bool moving_receptor() const {
@@ -52,6 +54,20 @@ struct user_settings {
 
     int exhaustiveness;
     int num_mc_steps;
+    int coarse_grid; //search grid has this many times fewer points per side
+    bool grid_fp16; //store the search grid in half precision
+    bool tiled_grid; //store the search grid in bricks
+    bool lazy_grid; //compute the search grid as it is used
+    unsigned lazy_grid_memory; //MB limit on a lazy grid, 0 for none
+    fl subbox_size; //search sub-boxes of about this size, 0 for the whole box
+    int replicas; //temperatures per replica exchange ladder, 1 for none
+    fl replica_max_temp; //temperature of the hottest replica
+    unsigned exchange_interval; //monte carlo steps between exchanges
+    fl ligands_per_hour; //target screening rate, 0 for fixed search settings
+    fl cpu_budget; //CPU hours for the whole screen, 0 for no limit
+    bool prefilter; //check that ligands can fit in the box before docking
+    int prefilter_exhaustiveness; //for ligands that don't, 0 to skip them
+    bool rigid_conformers; //dock each input conformer as a rigid body
     bool score_only;
     bool randomize_only;
     bool local_only;
@@ -65,7 +81,13 @@ struct user_settings {
     user_settings()
         : energy_range(2.0), num_modes(9), out_min_rmsd(1), forcecap(1000),
             seed(auto_seed()), verbosity(1), cpu(1), device(0),
-            exhaustiveness(10), num_mc_steps(0), score_only(false),
+            exhaustiveness(10), num_mc_steps(0), coarse_grid(1),
+            grid_fp16(false), tiled_grid(false), lazy_grid(false),
+            lazy_grid_memory(0), subbox_size(0), replicas(1),
+            replica_max_temp(4.8), exchange_interval(10),
+            ligands_per_hour(0), cpu_budget(0), prefilter(false),
+            prefilter_exhaustiveness(0), rigid_conformers(false),
+            score_only(false),
             randomize_only(false), local_only(false), dominimize(false),
             include_atom_info(false), gpu_on(false) {
 
@@ -46,6 +46,7 @@
 #include "array3d.h"
 #include "grid.h"
 #include "molgetter.h"
+#include "rescorer.h"
 #include "result_info.h"
 #include "box.h"
 #include "flexinfo.h"
@@ -57,6 +58,8 @@
 #include <boost/unordered_map.hpp>
 #include "sem.h"
 #include "user_opts.h"
+#include "search_budget.h"
+#include "pocket_filter.h"
 
 #include <cuda_profiler_api.h>
 
@@ -173,6 +176,33 @@ void refine_structure(model& m, const precalculate& prec, non_cache& nc,
   nc.setSlope(slope_orig);
 }
 
+//call f(i, m, nc) for every pose i < n.  With more than one thread, each
+//thread works on its own copy of m and its own non_cache like nc, since the
+//szv_grid_cache behind a non_cache fills itself in on demand and can't be
+//shared
+template<typename F>
+static void for_each_pose(sz n, model& m, non_cache& nc, sz nthreads, F f) {
+  if (nthreads <= 1 || n <= 1) {
+    VINA_FOR(i, n)
+      f(i, m, nc);
+    return;
+  }
+  const precalculate* p = nc.get_precalculate();
+  const grid_dims gd = nc.get_grid_dims();
+  const fl slope = nc.getSlope();
+  boost::thread_group threads;
+  for (sz t = 0; t < nthreads && t < n; t++) {
+    threads.create_thread([&, t]() {
+      model tm(m);
+      szv_grid_cache gridcache(tm, p->cutoff_sqr());
+      non_cache tnc(gridcache, gd, p, slope);
+      for (sz i = t; i < n; i += nthreads)
+        f(i, tm, tnc);
+    });
+  }
+  threads.join_all();
+}
+
 std::string vina_remark(fl e, fl lb, fl ub)
     {
   std::ostringstream remark;
@@ -192,6 +222,21 @@ output_container remove_redundant(const output_container& in, fl min_rmsd)
   return tmp;
 }
 
+//number of chains whose best pose is the same as top
+static sz count_agreeing(const output_container& chain_bests,
+    const output_type& top) {
+  sz n = 0;
+  VINA_FOR_IN(i, chain_bests)
+    if (rmsd_upper_bound(chain_bests[i].coords, top.coords) < 2) n++;
+  return n;
+}
+
+//with rigid conformers, make m the conformer that pose places
+static void use_conformer(model& m, const parallel_mc& par,
+    const output_type& pose) {
+  if (!par.conformers.empty()) m = *par.conformers[pose.conformer];
+}
+
 //print info to log about cnn scoring
 static void get_cnn_info(model& m, CNNScorer& cnn, tee& log, float& cnnscore,
     float& cnnaffinity, float& cnnforces) {
@@ -230,8 +275,21 @@ void do_search(model& m, const boost::optional<model>& ref,
     const parallel_mc& par, const user_settings& settings,
     bool compute_atominfo, tee& log,
     const terms *t, grid& user_grid, CNNScorer& cnn,
-    std::vector<result_info>& results)
+    std::vector<result_info>& results, search_budget* budget,
+    search_budget::allotment& allot)
     {
+  if (settings.score_only && !par.conformers.empty()) {
+    //rigid conformers are scored one by one, as they were read
+    parallel_mc single(par);
+    single.conformers.clear();
+    VINA_FOR_IN(i, par.conformers) {
+      model conformer = *par.conformers[i];
+      do_search(conformer, ref, sf, prec, ig, nc, corner1, corner2, single,
+          settings, compute_atominfo, log, t, user_grid, cnn, results, budget,
+          allot);
+    }
+    return;
+  }
   boost::timer::cpu_timer time;
 
   precalculate_exact exact_prec(sf); //use exact computations for final score
@@ -343,13 +401,59 @@ void do_search(model& m, const boost::optional<model>& ref,
     log << "Using random seed: " << settings.seed;
     log.endl();
     output_container out_cont;
+    output_container chain_bests;
     doing(settings.verbosity, "Performing search", log);
-    par(m, out_cont, prec, ig, corner1, corner2, generator, user_grid);
+    exchange_stats exchanges;
+    parallel_mc search(par);
+    search.exchanges = &exchanges;
+    search(m, out_cont, prec, ig, corner1, corner2, generator, user_grid,
+        budget ? &chain_bests : NULL);
+    //with a budget, ligands whose best pose was only found by one chain get
+    //more chains, paid for by time that earlier ligands saved
+    sz extra_chains = 0;
+    for (unsigned extra = 0; budget && extra < 2 && !out_cont.empty()
+        && count_agreeing(chain_bests, out_cont.front()) < 2; extra++) {
+      parallel_mc more(par);
+      more.num_tasks = budget->extend(allot);
+      if (more.num_tasks == 0) break;
+      output_container more_out;
+      more(m, more_out, prec, ig, corner1, corner2, generator, user_grid,
+          &chain_bests);
+      VINA_FOR_IN(i, more_out)
+        add_to_output_container(out_cont, more_out[i], 2,
+            par.mc.num_saved_mins);
+      out_cont.sort();
+      extra_chains += more.num_tasks;
+    }
     done(settings.verbosity, log);
+    if (par.num_replicas > 1 && settings.verbosity > 1)
+      log << "Replica exchange: " << exchanges.accepted << " of "
+          << exchanges.tried << " swaps accepted\n";
+    if (budget && settings.verbosity > 1)
+      log << "Search budget: " << par.num_tasks << " chains of "
+          << par.mc.num_steps << " steps, " << extra_chains
+          << " more chains\n";
+    //poses are refined and rescored independently, but the gpu and cnn
+    //versions of non_cache can't be copied for each thread
+    sz nthreads = 1;
+    if (!settings.gpu_on && !dynamic_cast<non_cache_cnn*>(&nc))
+      nthreads = std::max(1, settings.cpu);
+    if (settings.verbosity > 1) {
+      log << "Refining " << out_cont.size() << " poses on "
+          << std::min(nthreads, std::max(sz(1), out_cont.size()))
+          << " threads";
+      log.endl();
+    }
     doing(settings.verbosity, "Refining results", log);
+    for_each_pose(out_cont.size(), m, nc, nthreads,
+        [&](sz i, model& pm, non_cache& pnc) {
+          use_conformer(pm, par, out_cont[i]);
+          refine_structure(pm, prec, pnc, out_cont[i], authentic_v,
+              par.mc.ssd_par.minparm, user_grid, settings.gpu_on);
+        });
     VINA_FOR_IN(i, out_cont) {
-      refine_structure(m, prec, nc, out_cont[i], authentic_v,
-          par.mc.ssd_par.minparm, user_grid, settings.gpu_on);
+      use_conformer(m, par, out_cont[i]);
+      m.set(out_cont[i].c);
       get_cnn_info(m, cnn, log, cnnscore, cnnaffinity, cnnforces);
     }
 
@@ -360,13 +464,18 @@ void do_search(model& m, const boost::optional<model>& ref,
       if (!nc_cnn)
       {
         non_cache nc_base = *(dynamic_cast<non_cache*>(&nc));
+        use_conformer(m, par, out_cont[0]);
         const fl best_mode_intramolecular_energy = m.eval_intramolecular(prec,
             authentic_v, out_cont[0].c);
 
-        VINA_FOR_IN(i, out_cont)
-          if (not_max(out_cont[i].e))
-            out_cont[i].e = m.eval_adjusted(sf, prec, nc_base, authentic_v,
-                out_cont[i].c, best_mode_intramolecular_energy, user_grid);
+        for_each_pose(out_cont.size(), m, nc_base, nthreads,
+            [&](sz i, model& pm, non_cache& pnc) {
+              use_conformer(pm, par, out_cont[i]);
+              if (not_max(out_cont[i].e))
+                out_cont[i].e = pm.eval_adjusted(sf, prec, pnc, authentic_v,
+                    out_cont[i].c, best_mode_intramolecular_energy,
+                    user_grid);
+            });
         // the order must not change because of non-decreasing g (see paper), but we'll re-sort in case g is non strictly increasing
         out_cont.sort();
       }
@@ -383,10 +492,13 @@ void do_search(model& m, const boost::optional<model>& ref,
     log << "-----+------------+----------+----------\n";
 
     model best_mode_model = m;
-    if (!out_cont.empty())
+    if (!out_cont.empty()) {
+      use_conformer(best_mode_model, par, out_cont.front());
       best_mode_model.set(out_cont.front().c);
+    }
 
     sz how_many = 0;
+    const sz first_result = results.size();
     VINA_FOR_IN(i, out_cont)
     {
       if (how_many >= settings.num_modes || !not_max(out_cont[i].e)
@@ -395,6 +507,7 @@ void do_search(model& m, const boost::optional<model>& ref,
       ++how_many;
       log << std::setw(4) << i + 1 << "    " << std::setw(9)
           << std::setprecision(1) << out_cont[i].e; // intermolecular_energies[i];
+      use_conformer(m, par, out_cont[i]);
       m.set(out_cont[i].c);
       const model& r = ref ? ref.get() : best_mode_model;
       const fl lb = m.rmsd_lower_bound(r);
@@ -412,10 +525,14 @@ void do_search(model& m, const boost::optional<model>& ref,
       //dkoes - setup result_info
       results.push_back(
           result_info(out_cont[i].e, cnnscore, cnnaffinity, cnnforces, -1, m));
-
-      if (compute_atominfo)
-        results.back().setAtomValues(m, &sf);
-
+    }
+    if (compute_atominfo) {
+      for_each_pose(how_many, m, nc, nthreads,
+          [&](sz i, model& pm, non_cache&) {
+            use_conformer(pm, par, out_cont[i]);
+            pm.set(out_cont[i].c);
+            results[first_result + i].setAtomValues(pm, &sf);
+          });
     }
     done(settings.verbosity, log);
 
@@ -450,14 +567,76 @@ void load_ent_values(const grid_dims& gd, std::istream& user_in,
   std::cout << user_data(gd[0].n - 3, gd[1].n, gd[2].n) << "\n";
 }
 
+//same box with factor times fewer intervals along each side
+static grid_dims coarsen(const grid_dims& gd, int factor) {
+  grid_dims ret = gd;
+  if (factor > 1) {
+    VINA_FOR_IN(i, ret)
+      ret[i].n = std::max(sz(1), (gd[i].n + factor - 1) / factor);
+  }
+  return ret;
+}
+
+//farthest a movable heavy atom is from the root of the first ligand, i.e.
+//how far a pose reaches past the position conf::randomize picks
+static fl ligand_reach(const model& m) {
+  conf c = m.get_initial_conf(false);
+  if (c.ligands.empty()) return 0;
+  const vec& root = c.ligands[0].rigid.position;
+  vecv coords = m.get_heavy_atom_movable_coords();
+  fl reach = 0;
+  VINA_FOR_IN(i, coords)
+    reach = std::max(reach, (coords[i] - root).norm());
+  return reach;
+}
+
+//split gd into pieces no more than size on a side for blind docking.  Chains
+//start within the corners of a piece, and its grid extends margin past them
+//(but not past gd) so poses near the edges stay on the grid, which is what
+//makes neighboring grids overlap.  Grid points stay on the lattice of gd.
+static void split_box(const grid_dims& gd, fl size, fl margin,
+    std::vector<search_region>& regions, std::vector<grid_dims>& grids) {
+  sz pieces[3];
+  VINA_FOR(i, 3)
+    pieces[i] = std::max(sz(1), sz(std::ceil(gd[i].span() / size)));
+
+  VINA_FOR(x, pieces[0]) {
+    VINA_FOR(y, pieces[1]) {
+      VINA_FOR(z, pieces[2]) {
+        const sz piece[3] = { x, y, z };
+        vec corner1, corner2;
+        grid_dims sub;
+        VINA_FOR(i, 3) {
+          const grid_dim& d = gd[i];
+          const fl width = d.span() / pieces[i];
+          const fl spacing = d.span() / d.n;
+          corner1[i] = d.begin + width * piece[i];
+          corner2[i] = d.begin + width * (piece[i] + 1);
+          fl lo = std::max(fl(0),
+              std::floor((corner1[i] - margin - d.begin) / spacing));
+          fl hi = std::min(fl(d.n),
+              std::ceil((corner2[i] + margin - d.begin) / spacing));
+          sub[i].n = std::max(sz(1), sz(hi - lo));
+          sub[i].begin = d.begin + spacing * lo;
+          sub[i].end = sub[i].begin + spacing * sub[i].n;
+        }
+        regions.push_back(search_region(NULL, corner1, corner2));
+        grids.push_back(sub);
+      }
+    }
+  }
+}
+
 void main_procedure(model& m, precalculate& prec,
     const boost::optional<model>& ref, // m is non-const (FIXME?)
     const user_settings& settings,
     bool no_cache, bool compute_atominfo,
     const grid_dims& gd, minimization_params minparm,
     const weighted_terms& wt, tee& log,
-    std::vector<result_info>& results, grid& user_grid, CNNScorer& cnn)
+    std::vector<result_info>& results, grid& user_grid, CNNScorer& cnn,
+    search_budget* budget, const boost::ptr_vector<model>* conformers)
     {
+  boost::timer::cpu_timer ligand_time;
   doing(settings.verbosity, "Setting up the scoring function", log);
 
   done(settings.verbosity, log);
@@ -483,7 +662,19 @@ void main_procedure(model& m, precalculate& prec,
   par.mc.hunt_cap = vec(10, 10, 10);
   par.num_tasks = settings.exhaustiveness;
   par.num_threads = settings.cpu;
+  search_budget::allotment allot;
+  if (budget) {
+    allot = budget->assign(m, par.num_tasks, par.mc.num_steps);
+    par.num_tasks = allot.chains;
+    par.mc.num_steps = allot.steps;
+  }
+  par.num_replicas = settings.replicas;
+  par.max_temperature = settings.replica_max_temp;
+  par.exchange_interval = settings.exchange_interval;
   par.display_progress = true;
+  if (conformers && conformers->size() > 1)
+    VINA_FOR_IN(i, *conformers)
+      par.conformers.push_back(&(*conformers)[i]);
 
   szv_grid_cache gridcache(m, prec.cutoff_sqr());
   const fl slope = 1e3; // FIXME: too large? used to be 100
@@ -528,36 +719,105 @@ void main_procedure(model& m, precalculate& prec,
       do_search(m, ref, wt, prec, *nc, *nc, corner1, corner2, par,
           settings, compute_atominfo, log,
           wt.unweighted_terms(), user_grid, cnn,
-          results);
+          results, budget, allot);
     }
     else
     {
       bool cache_needed = !(settings.score_only || settings.randomize_only
           || settings.local_only);
 
-      if (cache_needed)
-        doing(settings.verbosity, "Analyzing the binding site", log);
+      //only the search uses the grid, refinement is done with nc
+      grid_dims search_gd = coarsen(gd, settings.coarse_grid);
+      grid_storage storage;
+      storage.compact = settings.grid_fp16;
+      storage.tiled = settings.tiled_grid;
+      storage.lazy = settings.lazy_grid;
+      storage.lazy_max_bytes = sz(settings.lazy_grid_memory) * 1024 * 1024;
       std::unique_ptr<cache> c(
           (settings.gpu_on &&
               !(settings.cnnopts.cnn_scoring ||
                   settings.cnnopts.cnn_refinement)) ?
               new cache_gpu("scoring_function_version001",
-                  gd, slope, dynamic_cast<precalculate_gpu*>(&prec)) :
-              new cache("scoring_function_version001", gd, slope));
+                  search_gd, slope, dynamic_cast<precalculate_gpu*>(&prec)) :
+              new cache("scoring_function_version001", search_gd, slope,
+                  storage));
+
+      //blind docking: chains in each sub-box search a smaller grid of its own
+      boost::ptr_vector<cache> subcaches;
+      if (cache_needed && settings.subbox_size > 0) {
+        std::vector<grid_dims> subgrids;
+        split_box(gd, settings.subbox_size, ligand_reach(m), par.regions,
+            subgrids);
+        if (par.regions.size() > 1) {
+          sz largest[3] = { 0, 0, 0 };
+          VINA_FOR_IN(i, subgrids) {
+            grid_dims sub_gd = coarsen(subgrids[i], settings.coarse_grid);
+            VINA_FOR(j, 3)
+              largest[j] = std::max(largest[j], sub_gd[j].n + 1);
+            subcaches.push_back(
+                new cache("scoring_function_version001", sub_gd, slope,
+                    storage));
+            par.regions[i].ig = &subcaches.back();
+          }
+          if (settings.verbosity > 1) {
+            log << "Searching " << par.regions.size()
+                << " sub-boxes of up to " << largest[0] << " x " << largest[1]
+                << " x " << largest[2] << " points";
+            log.endl();
+          }
+        } else
+          par.regions.clear(); //the box is small enough already
+      }
+
+      if (cache_needed && subcaches.empty() && settings.verbosity > 1) {
+        log << "Search grid: " << search_gd[0].n + 1 << " x "
+            << search_gd[1].n + 1 << " x " << search_gd[2].n + 1 << " points";
+        log.endl();
+      }
+
       if (cache_needed)
       {
+        doing(settings.verbosity, "Analyzing the binding site", log);
         std::vector<smt> atom_types_needed;
         m.get_movable_atom_types(atom_types_needed);
-        c->populate(m, prec, atom_types_needed, user_grid);
+        if (subcaches.empty())
+          c->populate(m, prec, atom_types_needed, user_grid);
+        else {
+          //the sub-box grids are independent, fill them in parallel
+          sz nthreads = std::max(1, settings.cpu);
+          boost::thread_group threads;
+          for (sz t = 0; t < nthreads && t < subcaches.size(); t++) {
+            threads.create_thread([&, t]() {
+              for (sz i = t; i < subcaches.size(); i += nthreads)
+                subcaches[i].populate(m, prec, atom_types_needed, user_grid,
+                    false);
+            });
+          }
+          threads.join_all();
+        }
         done(settings.verbosity, log);
       }
       do_search(m, ref, wt, prec, *c, *nc, corner1, corner2, par,
           settings, compute_atominfo, log,
-          wt.unweighted_terms(), user_grid, cnn, results);
+          wt.unweighted_terms(), user_grid, cnn, results, budget, allot);
+      const lazy_grid* lazy = c->lazy_tiles();
+      if (lazy && settings.verbosity > 1) {
+        log << "Lazy grid: computed "
+            << lazy->tiles_computed() + lazy->tiles_freed() << " of "
+            << lazy->total_tiles() << " tiles, freed " << lazy->tiles_freed();
+        log.endl();
+      }
     }
 
     delete nc;
   }
+  if (budget) {
+    //charge the docking threads for the whole time; process CPU time would
+    //include the reader, writer and compression threads working on other
+    //ligands
+    const fl wall = ligand_time.elapsed().wall / 1000000000.0;
+    budget->record(allot, wall * std::max(1, settings.cpu));
+  }
 }
 
 struct options_occurrence
@@ -814,18 +1074,23 @@ struct worker_job
     model* m;
     std::vector<result_info>* results;
     grid_dims gd;
+    std::string* prefilter; //why the ligand failed the prefilter, or NULL
+    boost::ptr_vector<model>* conformers; //rigid conformers of m, or NULL
 
     worker_job(unsigned int molid, model* m, std::vector<result_info>* results,
-        grid_dims gd)
+        grid_dims gd, std::string* prefilter = NULL,
+        boost::ptr_vector<model>* conformers = NULL)
         :
-            molid(molid), m(m), results(results), gd(gd)
+            molid(molid), m(m), results(results), gd(gd), prefilter(prefilter),
+            conformers(conformers)
     {
     }
     ;
 
     worker_job()
         :
-            molid(0), m(NULL), results(NULL)
+            molid(0), m(NULL), results(NULL), prefilter(NULL),
+            conformers(NULL)
     {
       for (int i = 0; i < 3; i++)
           {
@@ -905,13 +1170,15 @@ struct global_state
     tee* log;
     std::ofstream* atomoutfile;
     cnn_options cnnopts;
+    search_budget* budget;
 
     global_state(user_settings* settings, boost::shared_ptr<precalculate> prec,
         minimization_params* minparms, weighted_terms* wt,
-        grid* user_grid, tee* log, std::ofstream* atomoutfile, const cnn_options& co):
+        grid* user_grid, tee* log, std::ofstream* atomoutfile, const cnn_options& co,
+        search_budget* budget):
         settings(settings), prec(prec), minparms(minparms), wt(wt),
             user_grid(user_grid), log(log), atomoutfile(atomoutfile),
-            cnnopts(co)
+            cnnopts(co), budget(budget)
     {
     }
     ;
@@ -935,17 +1202,35 @@ void threads_at_work(job_queue<worker_job>* wrkq,
   {
     __sync_fetch_and_add(nligs, 1);
 
-    main_procedure(*(j.m), *gs->prec, boost::optional<model>(),
-        *gs->settings,
-        false, // no_cache == false
-        gs->atomoutfile->is_open()
-            || gs->settings->include_atom_info, j.gd,
-        *gs->minparms, *gs->wt, *gs->log, *(j.results),
-        *gs->user_grid, cnn_scorer);
+    if (j.prefilter && gs->settings->prefilter_exhaustiveness == 0) {
+      //the ligand can't fit, pass it through with the reason
+      j.results->push_back(result_info(*j.prefilter, *j.m));
+    } else {
+      //ligands that failed the prefilter get a cheap search
+      user_settings reduced;
+      const user_settings* settings = gs->settings;
+      if (j.prefilter) {
+        reduced = *gs->settings;
+        reduced.exhaustiveness = gs->settings->prefilter_exhaustiveness;
+        settings = &reduced;
+      }
+      main_procedure(*(j.m), *gs->prec, boost::optional<model>(),
+          *settings,
+          false, // no_cache == false
+          gs->atomoutfile->is_open()
+              || gs->settings->include_atom_info, j.gd,
+          *gs->minparms, *gs->wt, *gs->log, *(j.results),
+          *gs->user_grid, cnn_scorer, gs->budget, j.conformers);
+      if (j.prefilter)
+        VINA_FOR_IN(r, *j.results)
+          (*j.results)[r].setNote(*j.prefilter);
+    }
 
     writer_job k(j.molid, j.results);
     writerq->push(k);
     delete j.m;
+    delete j.prefilter;
+    delete j.conformers;
   }
 }
 
@@ -1073,6 +1358,7 @@ Thank you!\n";
     fl autobox_add = 4;
     std::string autobox_ligand;
     std::string flexdist_ligand;
+    std::string receptor_cache;
     std::string builtin_scoring;
     int flex_limit = -1;
     int flex_max = -1;
@@ -1091,12 +1377,15 @@ Thank you!\n";
     bool quiet = false;
     bool accurate_line = false;
     bool simple_ascent = false;
+    bool lbfgs = false;
     bool flex_hydrogens = false;
     bool print_terms = false;
     bool print_atom_types = false;
     bool add_hydrogens = true;
     bool strip_hydrogens = false;
     bool no_lig = false;
+    bool rescore = false;
+    bool rescore_terms = false;
 
     user_settings settings;
     cnn_options& cnnopts = settings.cnnopts;
@@ -1124,7 +1413,9 @@ Thank you!\n";
     ("flex_limit", value<int>(&flex_limit),
         "Hard limit for the number of flexible residues")
     ("flex_max", value<int>(&flex_max),
-        "Retain at at most the closes flex_max flexible residues");
+        "Retain at at most the closes flex_max flexible residues")
+    ("receptor_cache", value<std::string>(&receptor_cache),
+        "directory to store and reuse non-PDBQT receptors prepared with OpenBabel");
 
     //options_description search_area("Search area (required, except with --score_only)");
     options_description search_area("Search space (required)");
@@ -1166,6 +1457,10 @@ Thank you!\n";
         "custom atom type parameters file")
     ("score_only", bool_switch(&settings.score_only)->default_value(false),
         "score provided ligand pose")
+    ("rescore", bool_switch(&rescore),
+        "score many provided ligand poses in parallel, one line per pose")
+    ("rescore_terms", bool_switch(&rescore_terms),
+        "with --rescore also print unweighted term values")
     ("local_only", bool_switch(&settings.local_only)->default_value(false),
         "local search only using autobox (you probably want to use --minimize)")
     ("minimize", bool_switch(&settings.dominimize)->default_value(false),
@@ -1174,12 +1469,49 @@ Thank you!\n";
         "generate random poses, attempting to avoid clashes")
     ("num_mc_steps", value<int>(&settings.num_mc_steps),
         "number of monte carlo steps to take in each chain")
+    ("coarse_grid", value<int>(&settings.coarse_grid)->default_value(1),
+        "use a grid this many times coarser per side (2 = 1/8 the points) for the monte carlo search; final poses are still refined without a grid")
+    ("grid_fp16", bool_switch(&settings.grid_fp16),
+        "store the monte carlo search grid in half precision, halving its memory (CPU only)")
+    ("tiled_grid", bool_switch(&settings.tiled_grid),
+        "store the monte carlo search grid in 4x4x4 bricks for better cache locality with large boxes (CPU only)")
+    ("lazy_grid", bool_switch(&settings.lazy_grid),
+        "compute the monte carlo search grid in tiles as the search reaches them instead of all up front, for very large boxes (CPU only)")
+    ("lazy_grid_memory",
+        value<unsigned>(&settings.lazy_grid_memory)->default_value(0),
+        "with --lazy_grid, free the least recently used tiles when they take more than this many MB (0 for no limit)")
+    ("subbox_size", value<fl>(&settings.subbox_size)->default_value(0),
+        "for blind docking, split the box into sub-boxes about this many Angstroms on a side, each with its own overlapping grid and --exhaustiveness monte carlo chains (CPU only)")
+    ("prefilter", bool_switch(&settings.prefilter),
+        "before docking, check that each ligand's heavy atom volume and rigid fragments can fit in the free space of the box; ligands that can't are written out undocked with the reason")
+    ("prefilter_exhaustiveness",
+        value<int>(&settings.prefilter_exhaustiveness)->default_value(0),
+        "with --prefilter, dock ligands that fail at this exhaustiveness instead of skipping them (0 to skip)")
+    ("rigid_conformers", bool_switch(&settings.rigid_conformers),
+        "treat consecutive conformers of a molecule in the ligand file as one ligand and dock each of them as a rigid body, without torsions; the grids and --exhaustiveness chains are shared among the conformers; with --score_only each conformer is scored")
+    ("ligands_per_hour",
+        value<fl>(&settings.ligands_per_hour)->default_value(0),
+        "for screens, choose the number and length of monte carlo chains of each ligand to dock about this many ligands an hour, measuring the cost of ligands as they are docked; unconverged ligands get time saved on others (CPU only)")
+    ("cpu_budget", value<fl>(&settings.cpu_budget)->default_value(0),
+        "with --ligands_per_hour, total CPU hours for the screen; once used, the remaining ligands get the smallest search")
+    ("replicas", value<int>(&settings.replicas)->default_value(1),
+        "run the monte carlo chains as replica exchange ladders of this many temperatures that periodically swap conformations (CPU only)")
+    ("replica_max_temp",
+        value<fl>(&settings.replica_max_temp)->default_value(4.8),
+        "temperature of the hottest replica; the coldest runs at the usual 1.2")
+    ("exchange_interval",
+        value<unsigned>(&settings.exchange_interval)->default_value(10),
+        "monte carlo steps between replica exchange attempts")
     ("minimize_iters",
         value<unsigned>(&minparms.maxiters)->default_value(0),
         "number iterations of steepest descent; default scales with rotors and usually isn't sufficient for convergence")
     ("accurate_line", bool_switch(&accurate_line),
         "use accurate line search")
     ("simple_ascent", bool_switch(&simple_ascent), "use simple gradient ascent")
+    ("lbfgs", bool_switch(&lbfgs),
+        "use limited memory BFGS; faster with many flexible residues")
+    ("lbfgs_history", value<unsigned>(&minparms.history)->default_value(10),
+        "number of steps remembered by --lbfgs")
     ("minimize_early_term", bool_switch(&minparms.early_term),
         "Stop minimization before convergence conditions are fully met.")
     ("minimize_single_full", bool_switch(&minparms.single_min),
@@ -1222,6 +1554,9 @@ Thank you!\n";
         "resolution of grids, don't change unless you really know what you are doing")
     ("cnn_rotation", value<unsigned>(&cnnopts.cnn_rotations)->default_value(0),
         "evaluate multiple rotations of pose (max 24)")
+    ("cnn_precision",
+        value<std::string>(&cnnopts.cnn_precision)->default_value("fp32"),
+        "arithmetic for CPU CNN inference: fp32 or int8 (quantized, faster but slightly different scores)")
     ("cnn_scoring", bool_switch(&cnnopts.cnn_scoring),
         "Use a convolutional neural network to score poses.")
     ("cnn_refinement", bool_switch(&cnnopts.cnn_refinement),
@@ -1376,6 +1711,71 @@ Thank you!\n";
         approx_factor = 10;
     }
 
+    if (rescore) {
+      if (cnnopts.cnn_scoring || settings.gpu_on || settings.dominimize
+          || settings.local_only || settings.randomize_only)
+        throw usage_error("--rescore only supports CPU scoring of provided poses");
+      if (out_name.size() > 0 || outf_name.size() > 0
+          || usergrid_file_name.size() > 0 || vm.count("atom_terms") > 0)
+        throw usage_error("--rescore does not support output structures, atom terms or user grids");
+      if (ligand_names.size() == 0)
+        throw usage_error("--rescore needs ligands");
+      settings.score_only = true;
+    }
+
+    if (settings.coarse_grid < 1)
+      throw usage_error("--coarse_grid must be at least 1");
+    if (settings.coarse_grid > 1 && usergrid_file_name.size() > 0)
+      throw usage_error("--coarse_grid is not supported with user grids");
+    if (lbfgs && settings.gpu_on)
+      throw usage_error("--lbfgs is not supported with --gpu");
+    if ((settings.grid_fp16 || settings.tiled_grid) && settings.gpu_on)
+      throw usage_error("--grid_fp16 and --tiled_grid are not supported with --gpu");
+    if (settings.lazy_grid) {
+      if (settings.gpu_on)
+        throw usage_error("--lazy_grid is not supported with --gpu");
+      if (settings.grid_fp16 || settings.tiled_grid)
+        throw usage_error("--lazy_grid can not be combined with --grid_fp16 or --tiled_grid");
+      if (usergrid_file_name.size() > 0)
+        throw usage_error("--lazy_grid is not supported with user grids");
+    }
+    if (settings.subbox_size < 0)
+      throw usage_error("--subbox_size must not be negative");
+    if (settings.subbox_size > 0
+        && (settings.gpu_on || settings.cnnopts.cnn_scoring
+            || usergrid_file_name.size() > 0))
+      throw usage_error("--subbox_size is not supported with --gpu, --cnn_scoring or user grids");
+    if (settings.prefilter_exhaustiveness < 0)
+      throw usage_error("--prefilter_exhaustiveness must not be negative");
+    if (settings.prefilter
+        && (settings.score_only || settings.local_only
+            || settings.randomize_only))
+      throw usage_error("--prefilter only applies to docking");
+    if (settings.ligands_per_hour < 0 || settings.cpu_budget < 0)
+      throw usage_error("--ligands_per_hour and --cpu_budget must not be negative");
+    if (settings.cpu_budget > 0 && settings.ligands_per_hour == 0)
+      throw usage_error("--cpu_budget needs --ligands_per_hour");
+    if (settings.ligands_per_hour > 0
+        && (settings.gpu_on || settings.score_only || settings.local_only
+            || settings.randomize_only || settings.subbox_size > 0))
+      throw usage_error("--ligands_per_hour only applies to docking on the CPU without --subbox_size");
+    if (settings.replicas < 1)
+      throw usage_error("--replicas must be at least 1");
+    if (settings.replicas > 1) {
+      if (settings.gpu_on || settings.cnnopts.cnn_scoring)
+        throw usage_error("--replicas is not supported with --gpu or --cnn_scoring");
+      if (settings.ligands_per_hour > 0)
+        throw usage_error("--replicas is not supported with --ligands_per_hour");
+      if (settings.replica_max_temp <= monte_carlo().temperature)
+        throw usage_error("--replica_max_temp must be above the base temperature of 1.2");
+      if (settings.exchange_interval < 1)
+        throw usage_error("--exchange_interval must be at least 1");
+    }
+    if (settings.rigid_conformers
+        && (settings.gpu_on || settings.replicas > 1
+            || settings.local_only || settings.randomize_only))
+      throw usage_error("--rigid_conformers only applies to docking or scoring on the CPU without --replicas");
+
     if (settings.gpu_on) {
       cudaDeviceReset();
       cudaDeviceSetLimit(cudaLimitStackSize, 5120);
@@ -1386,6 +1786,14 @@ Thank you!\n";
       minparms.type = minimization_params::BFGSAccurateLineSearch;
     }
 
+    if (lbfgs)
+    {
+      if (minparms.type == minimization_params::BFGSAccurateLineSearch)
+        minparms.type = minimization_params::LBFGSAccurateLineSearch;
+      else
+        minparms.type = minimization_params::LBFGSFastLineSearch;
+    }
+
     if (simple_ascent)
     {
       minparms.type = minimization_params::Simple;
@@ -1466,7 +1874,8 @@ Thank you!\n";
     FlexInfo finfo(flex_res, flex_dist, flexdist_ligand, nflex, nflex_hard_limit, log);
 
     // dkoes - parse in receptor once
-    MolGetter mols(rigid_name, flex_name, finfo, add_hydrogens, strip_hydrogens, log);
+    MolGetter mols(rigid_name, flex_name, finfo, add_hydrogens, strip_hydrogens,
+        log, receptor_cache);
 
     if (autobox_ligand.length() > 0) {
       setup_autobox(mols.getInitModel(),autobox_ligand, autobox_add,
@@ -1596,7 +2005,11 @@ Thank you!\n";
       OpenBabel::obErrorLog.SetOutputLevel(OpenBabel::obError);
     }
     //dkoes, hoist precalculation outside of loop
-    weighted_terms wt(&t, t.weights());
+    //built-in functions get their fused evaluator
+    std::unique_ptr<weighted_terms> fused_wt(new_weighted_terms(&t,
+        t.weights(), custom_file_name.size() > 0 ? "" :
+            builtin_scoring.size() > 0 ? builtin_scoring : "vina"));
+    weighted_terms& wt = *fused_wt;
 
     boost::shared_ptr<precalculate> prec;
 
@@ -1615,19 +2028,30 @@ Thank you!\n";
       prec = boost::shared_ptr<precalculate>(
           new precalculate_exact(wt));
 
+    if (rescore) {
+      boost::timer::cpu_timer time;
+      BatchRescorer rescorer(wt, settings.forcecap, settings.cpu,
+          rescore_terms);
+      size_t n = rescorer.run(mols, ligand_names, log);
+      if (settings.verbosity > 1)
+        log << "Rescored " << n << " poses in "
+            << time.elapsed().wall / 1000000000.0 << "s\n";
+      return 0;
+    }
+
     //setup single outfile
     using namespace OpenBabel;
     ozfile outfile;
     std::string outext;
     if (out_name.length() > 0) {
-      outext = outfile.open(out_name);
+      outext = outfile.open(out_name, std::max(1, settings.cpu));
     }
 
     ozfile outflex;
     std::string outfext;
     if (outf_name.length() > 0)
     {
-      outfext = outflex.open(outf_name);
+      outfext = outflex.open(outf_name, std::max(1, settings.cpu));
     }
 
     if (settings.score_only) //output header
@@ -1650,15 +2074,22 @@ Thank you!\n";
     job_queue<writer_job> writerq;
     int nligs = 0;
     size_t nthreads = settings.cpu;
+    if (!settings.local_only)
+      nthreads = 1; //docking is multithreaded already, don't add additional parallelism other than pipeline
+    //the cores not used by other worker threads speed up CPU convolutions
+    cnnopts.cpu_threads = std::max(size_t(1), settings.cpu / nthreads);
+    std::unique_ptr<search_budget> budget;
+    if (settings.ligands_per_hour > 0)
+      budget.reset(new search_budget(settings.cpu_budget * 3600,
+          settings.ligands_per_hour, settings.cpu));
     global_state gs(&settings, prec, &minparms, &wt, &user_grid,
-        &log, &atomoutfile, cnnopts);
+        &log, &atomoutfile, cnnopts, budget.get());
+    std::unique_ptr<pocket_filter> pocket; //made with the first ligand
+    sz prefiltered = 0, read = 0;
     boost::thread_group worker_threads;
     boost::timer::cpu_timer time;
     CNNScorer cnn_scorer(cnnopts); //shared network
 
-    if (!settings.local_only)
-      nthreads = 1; //docking is multithreaded already, don't add additional parallelism other than pipeline
-
     //launch worker threads to process ligands in the work queue
     for (int i = 0; i < nthreads; i++)
         {
@@ -1682,12 +2113,31 @@ Thank you!\n";
 
         for (;;)  {
           model* m = new model;
-
-          if (!mols.readMoleculeIntoModel(*m))
-              {
-            delete m;
-            break;
-          }
+          boost::ptr_vector<model>* conformers = NULL;
+
+          if (settings.rigid_conformers) {
+            conformers = new boost::ptr_vector<model>();
+            if (!mols.readConformersIntoModels(*conformers)) {
+              delete conformers;
+              delete m;
+              break;
+            }
+            VINA_FOR_IN(c, *conformers)
+              (*conformers)[c].set_pose_num(i);
+            *m = conformers->front();
+            if (conformers->size() == 1) {
+              delete conformers;
+              conformers = NULL;
+            } else
+              if (settings.verbosity > 1)
+                log << "Docking " << conformers->size()
+                    << " rigid conformers of " << m->get_name() << "\n";
+          } else
+            if (!mols.readMoleculeIntoModel(*m))
+                {
+              delete m;
+              break;
+            }
           m->set_pose_num(i);
           m->gdata.device_on = settings.gpu_on;
           m->gdata.device_id = settings.device;
@@ -1698,9 +2148,21 @@ Thank you!\n";
           }
 
           done(settings.verbosity, log);
+          std::string* rejected = NULL;
+          if (settings.prefilter) {
+            if (!pocket) pocket.reset(new pocket_filter(*m, gd));
+            std::string why = pocket->check(*m);
+            if (why.size() > 0) {
+              prefiltered++;
+              if (settings.verbosity > 0)
+                log << "Prefilter: " << m->get_name() << ": " << why << "\n";
+              rejected = new std::string(why);
+            }
+          }
+          read++;
           std::vector<result_info>* results =
               new std::vector<result_info>();
-          worker_job j(i, m, results, gd);
+          worker_job j(i, m, results, gd, rejected, conformers);
           wrkq.push(j);
 
           i++;
@@ -1728,6 +2190,12 @@ Thank you!\n";
     cudaDeviceSynchronize();
 
     std::cout << "Loop time " << time.elapsed().wall / 1000000000.0 << "\n";
+    if (settings.prefilter)
+      std::cout << "Prefilter caught " << prefiltered << " of " << read
+          << " ligands\n";
+    if (budget)
+      std::cout << "Search budget used " << budget->seconds_spent() / 3600
+          << " CPU hours\n";
 
   } catch (file_error& e)
   {
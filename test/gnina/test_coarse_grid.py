@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+
+'''Check that --coarse_grid searches a grid with fewer points over the same
+box and that refinement without the grid still recovers a pose scoring
+within tolerance of the full resolution search'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+args = '{gnina} -r data/10gs_rec.pdb -l data/10gs_lig.sdf \
+    --autobox_ligand data/10gs_lig.sdf --autobox_add 8 --seed 5 \
+    --exhaustiveness 4 --cpu 2 -v 2'.format(gnina=gnina)
+tolerance = 1.0  # kcal/mol between the best poses
+
+def dock(extra):
+    out = subprocess.check_output(args + ' ' + extra, shell=True).decode()
+    dims = re.search(r'Search grid: (\d+) x (\d+) x (\d+) points', out)
+    energies = re.findall(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', out, re.M)
+    return [int(d) for d in dims.groups()], float(energies[0])
+
+fine, finee = dock('')
+coarse, coarsee = dock('--coarse_grid 2')
+print('full grid', fine, finee, 'coarse grid', coarse, coarsee)
+
+# n intervals (n+1 points) per side become ceil(n/2) intervals
+for f, c in zip(fine, coarse):
+    n = f - 1
+    assert c == (n + 1) // 2 + 1
+assert coarsee < finee + tolerance
@@ -0,0 +1,213 @@
+#include <random>
+#include "flat_tree.h"
+#include "conf.h"
+#include "random.h"
+#include "test_flat_tree.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+//a random ligand and flexible residues sharing one atom array, with the
+//same trees kept twice: ref is posed with tree.h, flat is only ever updated
+//through a flat_tree
+struct random_trees {
+    std::mt19937 engine;
+    vecv lab; //initial atom coordinates
+    sz next_atom;
+    atomv atoms;
+    std::vector<flexible_body> ligands, flat_ligands;
+    std::vector<main_branch> flex, flat_flex;
+    conf_size size;
+    flat_tree kinematics;
+
+    random_trees(unsigned seed)
+        : engine(seed), next_atom(0) {
+      std::uniform_real_distribution<float> coord_dist(-10, 10);
+      lab.resize(500);
+      VINA_FOR_IN(i, lab)
+        lab[i] = vec(coord_dist(engine), coord_dist(engine),
+            coord_dist(engine));
+
+      sz b = take_atoms();
+      ligands.push_back(flexible_body(rigid_body(lab[b], b, next_atom)));
+      add_branches(ligands[0].children, lab[b], 0);
+      VINA_FOR(r, 2) {
+        //the first segment of a residue turns about the bond to its
+        //immobile parent atom
+        sz root = take_atoms();
+        flex.push_back(main_branch(first_segment(lab[root + 1], root + 1,
+            next_atom, lab[root])));
+        add_branches(flex.back().children, lab[root + 1], 0);
+      }
+      atoms.resize(next_atom);
+
+      VINA_FOR_IN(i, ligands) {
+        sz n = 0;
+        count_torsions(ligands[i], n);
+        size.ligands.push_back(n);
+        set_internal(ligands[i]);
+        kinematics.add_ligand(ligands[i]);
+      }
+      VINA_FOR_IN(i, flex) {
+        sz n = 0;
+        count_torsions(flex[i], n);
+        size.flex.push_back(n);
+        set_internal(flex[i]);
+        kinematics.add_residue(flex[i]);
+      }
+      flat_ligands = ligands;
+      flat_flex = flex;
+    }
+
+    sz take_atoms() {
+      std::uniform_int_distribution<int> natoms_dist(2, 4);
+      sz b = next_atom;
+      next_atom += natoms_dist(engine);
+      return b;
+    }
+
+    void add_branches(branches& children, const vec& parent_origin,
+        unsigned depth) {
+      std::uniform_int_distribution<int> nchildren_dist(0, 3);
+      int n = depth < 3 ? nchildren_dist(engine) : 0;
+      VINA_FOR(i, n) {
+        sz b = take_atoms();
+        children.push_back(branch(segment(lab[b], b, next_atom,
+            parent_origin, frame(parent_origin))));
+        add_branches(children.back().children, lab[b], depth + 1);
+      }
+    }
+
+    //atom coordinates relative to the frame of their node, as in a model
+    template<typename T>
+    void set_internal(const T& t) {
+      VINA_RANGE(i, t.node.begin, t.node.end)
+        atoms[i].coords = lab[i] - t.node.get_origin();
+      VINA_FOR_IN(i, t.children)
+        set_internal(t.children[i]);
+    }
+
+    conf random_conf() {
+      conf c(size, false);
+      rng generator(engine());
+      c.randomize(vec(-10, -10, -10), vec(10, 10, 10), generator);
+      return c;
+    }
+
+    void set_ref(const conf& c, vecv& coords) {
+      VINA_FOR_IN(i, ligands)
+        ligands[i].set_conf(atoms, coords, c.ligands[i]);
+      VINA_FOR_IN(i, flex)
+        flex[i].set_conf(atoms, coords, c.flex[i]);
+    }
+
+    void ref_derivative(const vecv& coords, const vecv& forces,
+        const std::vector<flexible_body>& ligs,
+        const std::vector<main_branch>& res, change& g) {
+      VINA_FOR_IN(i, ligs)
+        ligs[i].derivative(coords, forces, g.ligands[i]);
+      VINA_FOR_IN(i, res)
+        res[i].derivative(coords, forces, g.flex[i]);
+    }
+};
+
+static void check_same(const vecv& a, const vecv& b) {
+  BOOST_REQUIRE_EQUAL(a.size(), b.size());
+  VINA_FOR_IN(i, a)
+    VINA_FOR(d, 3)
+      BOOST_CHECK_EQUAL(a[i][d], b[i][d]);
+}
+
+static void check_same(const change& a, const change& b) {
+  VINA_FOR_IN(i, a.ligands) {
+    VINA_FOR(d, 3) {
+      BOOST_CHECK_EQUAL(a.ligands[i].rigid.position[d],
+          b.ligands[i].rigid.position[d]);
+      BOOST_CHECK_EQUAL(a.ligands[i].rigid.orientation[d],
+          b.ligands[i].rigid.orientation[d]);
+    }
+    VINA_FOR_IN(t, a.ligands[i].torsions)
+      BOOST_CHECK_EQUAL(a.ligands[i].torsions[t], b.ligands[i].torsions[t]);
+  }
+  VINA_FOR_IN(i, a.flex)
+    VINA_FOR_IN(t, a.flex[i].torsions)
+      BOOST_CHECK_EQUAL(a.flex[i].torsions[t], b.flex[i].torsions[t]);
+}
+
+void test_flat_tree_set_conf() {
+  p_args.log << "Flat Tree Set Conf Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  random_trees t(p_args.seed);
+  vecv ref_coords(t.atoms.size()), flat_coords(t.atoms.size());
+
+  conf c = t.random_conf();
+  t.set_ref(c, ref_coords);
+  t.kinematics.set_conf(t.atoms, flat_coords, c);
+  check_same(ref_coords, flat_coords);
+
+  //only the residues move with set_flex_conf
+  conf c2 = t.random_conf();
+  c2.ligands = c.ligands;
+  t.set_ref(c2, ref_coords);
+  t.kinematics.set_flex_conf(t.atoms, flat_coords, c2);
+  check_same(ref_coords, flat_coords);
+
+  //root origins are read from the flat tree, the trees are left stale
+  VINA_FOR_IN(i, t.ligands)
+    VINA_FOR(d, 3)
+      BOOST_CHECK_EQUAL(t.kinematics.origin(i)[d],
+          t.ligands[i].node.get_origin()[d]);
+  VINA_FOR_IN(i, t.flex)
+    VINA_FOR(d, 3)
+      BOOST_CHECK_EQUAL(t.kinematics.origin(t.ligands.size() + i)[d],
+          t.flex[i].node.get_origin()[d]);
+}
+
+void test_flat_tree_derivative() {
+  p_args.log << "Flat Tree Derivative Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  random_trees t(p_args.seed);
+  vecv ref_coords(t.atoms.size()), flat_coords(t.atoms.size());
+  conf c = t.random_conf();
+  t.set_ref(c, ref_coords);
+  t.kinematics.set_conf(t.atoms, flat_coords, c);
+
+  std::uniform_real_distribution<float> force_dist(-1, 1);
+  vecv forces(t.atoms.size());
+  VINA_FOR_IN(i, forces)
+    forces[i] = vec(force_dist(t.engine), force_dist(t.engine),
+        force_dist(t.engine));
+
+  change ref_g(t.size, false), flat_g(t.size, false);
+  t.ref_derivative(ref_coords, forces, t.ligands, t.flex, ref_g);
+  t.kinematics.derivative(flat_coords, forces, flat_g);
+  check_same(ref_g, flat_g);
+
+  //the tree.h derivative reads node origins and axes, so it only agrees on
+  //trees whose frames were stored from the flat tree
+  change stored_g(t.size, false);
+  t.kinematics.store_frames(t.flat_ligands, t.flat_flex);
+  t.ref_derivative(ref_coords, forces, t.flat_ligands, t.flat_flex, stored_g);
+  check_same(ref_g, stored_g);
+
+  //the same, for unposed copies of the trees appended after those of
+  //another model
+  random_trees other(p_args.seed + 1), unposed(p_args.seed);
+  std::vector<flexible_body> ligs(other.ligands);
+  std::vector<main_branch> res(other.flex);
+  ligs.insert(ligs.end(), unposed.ligands.begin(), unposed.ligands.end());
+  res.insert(res.end(), unposed.flex.begin(), unposed.flex.end());
+  t.kinematics.store_frames(ligs, res, other.ligands.size(),
+      other.flex.size());
+  change appended_g(t.size, false);
+  t.ref_derivative(ref_coords, forces,
+      std::vector<flexible_body>(ligs.begin() + other.ligands.size(),
+          ligs.end()),
+      std::vector<main_branch>(res.begin() + other.flex.size(), res.end()),
+      appended_g);
+  check_same(ref_g, appended_g);
+}
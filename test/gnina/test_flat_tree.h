@@ -0,0 +1,4 @@
+#pragma once
+
+void test_flat_tree_set_conf();
+void test_flat_tree_derivative();
@@ -0,0 +1,94 @@
+#include <cmath>
+#include <limits>
+#include <random>
+#include "fp16.h"
+#include "test_fp16.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+//smallest positive subnormal half, 2^-24
+static const float half_denorm_min = std::ldexp(1.0f, -24);
+
+void test_fp16_roundtrip() {
+  p_args.log << "FP16 Roundtrip Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+
+  //every finite half survives a trip through float
+  for (uint32_t h = 0; h < 0x10000u; ++h) {
+    if ((h & 0x7c00u) == 0x7c00u) continue; //inf and nan
+    float f = half_to_float(uint16_t(h));
+    BOOST_CHECK_EQUAL(float_to_half(f), h);
+  }
+
+  //random floats in range round to a neighbouring half, within half an ulp
+  std::mt19937 engine(p_args.seed);
+  std::uniform_real_distribution<float> value_dist(-FP16_MAX, FP16_MAX);
+  for (size_t i = 0; i < 10000; ++i) {
+    float f = value_dist(engine);
+    float back = half_to_float(float_to_half(f));
+    int e;
+    std::frexp(f, &e);
+    //halves have 11 significant bits
+    float ulp = std::ldexp(1.0f, std::max(e - 11, -24));
+    BOOST_CHECK_LE(std::fabs(back - f), ulp / 2);
+  }
+}
+
+void test_fp16_saturation() {
+  p_args.log << "FP16 Saturation Test \n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+
+  BOOST_CHECK_EQUAL(half_to_float(0x7bffu), FP16_MAX);
+  BOOST_CHECK_EQUAL(half_to_float(0xfbffu), -FP16_MAX);
+  BOOST_CHECK_EQUAL(float_to_half(FP16_MAX), 0x7bffu);
+  BOOST_CHECK_EQUAL(float_to_half(-FP16_MAX), 0xfbffu);
+
+  //values that would round to or beyond infinity in IEEE conversion
+  //saturate at the largest finite half instead
+  const float big[] = { 65519.0f, 65520.0f, 70000.0f, 1e10f,
+      std::numeric_limits<float>::max(),
+      std::numeric_limits<float>::infinity() };
+  for (float f : big) {
+    BOOST_CHECK_EQUAL(float_to_half(f), 0x7bffu);
+    BOOST_CHECK_EQUAL(float_to_half(-f), 0xfbffu);
+    BOOST_CHECK_EQUAL(half_to_float(float_to_half(f)), FP16_MAX);
+  }
+
+  //nan stays nan
+  float nan = half_to_float(
+      float_to_half(std::numeric_limits<float>::quiet_NaN()));
+  BOOST_CHECK(std::isnan(nan));
+}
+
+void test_fp16_subnormal() {
+  p_args.log << "FP16 Subnormal Test \n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+
+  //subnormal halves are exact multiples of 2^-24
+  for (uint32_t k = 0; k < 0x400u; ++k) {
+    float f = k * half_denorm_min;
+    BOOST_CHECK_EQUAL(half_to_float(uint16_t(k)), f);
+    BOOST_CHECK_EQUAL(half_to_float(uint16_t(k | 0x8000u)), -f);
+    BOOST_CHECK_EQUAL(float_to_half(f), k);
+    BOOST_CHECK_EQUAL(float_to_half(-f), k | 0x8000u);
+
+    //halfway between two subnormals rounds to the even one
+    float mid = (k + 0.5f) * half_denorm_min;
+    BOOST_CHECK_EQUAL(float_to_half(mid), (k & 1) ? k + 1 : k);
+  }
+
+  //the largest subnormal and the smallest normal are neighbours
+  BOOST_CHECK_EQUAL(half_to_float(0x03ffu), 1023 * half_denorm_min);
+  BOOST_CHECK_EQUAL(half_to_float(0x0400u), std::ldexp(1.0f, -14));
+
+  //anything below half the smallest subnormal flushes to a signed zero
+  BOOST_CHECK_EQUAL(float_to_half(half_denorm_min / 4), 0u);
+  BOOST_CHECK_EQUAL(float_to_half(-half_denorm_min / 4), 0x8000u);
+  BOOST_CHECK_EQUAL(float_to_half(std::numeric_limits<float>::denorm_min()),
+      0u);
+}
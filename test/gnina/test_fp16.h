@@ -0,0 +1,5 @@
+#pragma once
+
+void test_fp16_roundtrip();
+void test_fp16_saturation();
+void test_fp16_subnormal();
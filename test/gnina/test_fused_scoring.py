@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+
+'''Check that the built-in scoring functions, which are evaluated by fused
+evaluators, score exactly as the same terms do through the generic
+--custom_scoring path: the term breakdown, intramolecular energy and
+affinity printed by --score_only must be identical'''
+
+import sys, os, re, struct, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+# the built-in functions as custom scoring files; weights are written as the
+# single precision values the built-in functions use
+functions = {
+    'vina': [
+        ('gauss(o=0,_w=0.5,_c=8)', -0.035579),
+        ('gauss(o=3,_w=2,_c=8)', -0.005156),
+        ('repulsion(o=0,_c=8)', 0.840245),
+        ('hydrophobic(g=0.5,_b=1.5,_c=8)', -0.035069),
+        ('non_dir_h_bond(g=-0.7,_b=0,_c=8)', -0.587439),
+        ('num_tors_div', 5 * 0.05846 / 0.1 - 1)],
+    'vinardo': [
+        ('gauss(o=0,_w=0.8,_c=8)', -0.045),
+        ('repulsion(o=0,_c=8)', 0.80),
+        ('hydrophobic(g=0.0,_b=2.5,_c=8)', -0.035),
+        ('non_dir_h_bond(g=-0.6,_b=0,_c=8)', -0.60),
+        ('num_tors_div', 5 * 0.02 / 0.1 - 1)],
+    'dkoes_scoring': [
+        ('vdw(i=4,_j=8,_s=0,_^=100,_c=8)', 0.009900),
+        ('non_dir_h_bond(g=-0.7,_b=0,_c=8)', -0.153055),
+        ('ad4_solvation(d-sigma=3.6,_s/q=0.01097,_c=8)', 0.048934),
+        ('num_tors_sqr', 0.317267),
+        ('constant_term', -2.469020)],
+    'ad4_scoring': [
+        ('vdw(i=6,_j=12,_s=0,_^=100,_c=8)', 0.1560),
+        ('non_dir_h_bond_lj(o=-0.7,_^=100,_c=8)', 0.0974),
+        ('ad4_solvation(d-sigma=3.5,_s/q=0.01097,_c=8)', 0.1159),
+        ('electrostatic(i=1,_^=100,_c=8)', 0.1465),
+        ('num_tors_add', 0.2744)]}
+
+# vinardo's atom parameters where they differ from the defaults, in
+# --custom_atoms order
+vinardo_atoms = '''\
+Hydrogen 1.0 0.02 0.00051 0.0 0.37 0.0 0 0 0 0
+PolarHydrogen 1.0 0.02 0.00051 0.0 0.37 0.0 0 0 0 0
+AliphaticCarbonXSHydrophobe 2.0 0.15 -0.00143 33.5103 0.77 2.0 1 0 0 0
+AliphaticCarbonXSNonHydrophobe 2.0 0.15 -0.00143 33.5103 0.77 2.0 0 0 0 0
+AromaticCarbonXSNonHydrophobe 2.0 0.15 -0.00052 33.5103 0.77 1.9 1 0 0 0
+Nitrogen 1.75 0.16 -0.00162 22.4493 0.75 1.7 0 0 0 1
+NitrogenXSDonor 1.75 0.16 -0.00162 22.4493 0.75 1.7 0 1 0 1
+NitrogenXSDonorAcceptor 1.75 0.16 -0.00162 22.4493 0.75 1.7 0 1 1 1
+NitrogenXSAcceptor 1.75 0.16 -0.00162 22.4493 0.75 1.7 0 0 1 1
+Oxygen 1.6 0.2 -0.00251 17.1573 0.73 1.6 0 0 0 1
+OxygenXSDonor 1.6 0.2 -0.00251 17.1573 0.73 1.6 0 1 0 1
+OxygenXSDonorAcceptor 1.6 0.2 -0.00251 17.1573 0.73 1.6 0 1 1 1
+OxygenXSAcceptor 1.6 0.2 -0.00251 17.1573 0.73 1.6 0 0 1 1
+SulfurAcceptor 2.0 0.2 -0.00214 33.5103 1.02 2.0 1 0 0 1
+'''
+
+tmpdir = tempfile.mkdtemp()
+
+def single(w):
+    return '%.9g' % struct.unpack('f', struct.pack('f', w))[0]
+
+def scores(system, extra):
+    out = subprocess.check_output('{gnina} -r data/{system}_rec.pdb \
+        -l data/{system}_lig.sdf --score_only --cpu 1 {extra}'.format(
+        gnina=gnina, system=system, extra=extra), shell=True).decode()
+    affinity = re.search(r'^Affinity:\s+(\S+)', out, re.M).group(1)
+    intra = re.search(r'^Intramolecular energy:\s+(\S+)', out, re.M).group(1)
+    header = re.search(r'^## Name .*$', out, re.M).group(0)
+    terms = re.findall(r'^## (?!Name ).*$', out, re.M)
+    assert len(terms) == 1
+    return affinity, intra, header, terms[0]
+
+for name, terms in functions.items():
+    custom = os.path.join(tmpdir, name + '.txt')
+    with open(custom, 'w') as f:
+        for term, w in terms:
+            f.write('%s %s\n' % (single(w), term))
+    generic = '--custom_scoring ' + custom
+    if name == 'vinardo':
+        atoms = os.path.join(tmpdir, 'vinardo_atoms.txt')
+        with open(atoms, 'w') as f:
+            for line in vinardo_atoms.splitlines():
+                fields = line.split()
+                f.write(' '.join(fields[:1] + [single(float(x))
+                    for x in fields[1:7]] + fields[7:]) + '\n')
+        generic += ' --custom_atoms ' + atoms
+
+    for system in ['10gs', '184l']:
+        fused = scores(system, '--scoring ' + name)
+        baseline = scores(system, generic)
+        print(name, system, fused[0], fused[1])
+        assert fused == baseline, (name, system, fused, baseline)
+        assert float(fused[0]) != 0
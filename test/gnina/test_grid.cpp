@@ -0,0 +1,73 @@
+#include <random>
+#include "grid.h"
+#include "test_grid.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+//fill grids of every storage layout with the same values
+static void make_grids(grid* grids, const grid_storage* storage, sz ngrids,
+    std::mt19937& engine) {
+  //dimensions that are not multiples of the brick size exercise the padding
+  std::uniform_int_distribution<sz> n_dist(1, 13);
+  std::uniform_real_distribution<fl> begin_dist(-10, 10);
+  std::uniform_real_distribution<fl> span_dist(2, 12);
+  grid_dims gd;
+  for (sz i = 0; i < 3; ++i) {
+    gd[i].begin = begin_dist(engine);
+    gd[i].end = gd[i].begin + span_dist(engine);
+    gd[i].n = n_dist(engine);
+  }
+  for (sz g = 0; g < ngrids; ++g)
+    grids[g].init(gd, true, storage[g]);
+
+  std::uniform_real_distribution<fl> value_dist(-5, 5);
+  for (sz x = 0; x <= gd[0].n; ++x)
+    for (sz y = 0; y <= gd[1].n; ++y)
+      for (sz z = 0; z <= gd[2].n; ++z) {
+        fl value = value_dist(engine);
+        fl charge = value_dist(engine);
+        for (sz g = 0; g < ngrids; ++g) {
+          grids[g].set(x, y, z, value);
+          grids[g].set_charge(x, y, z, charge);
+        }
+      }
+}
+
+void test_grid_tiled() {
+  p_args.log << "Tiled Grid Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  std::mt19937 engine(p_args.seed);
+
+  //flat, tiled, and the same two in half precision
+  grid_storage storage[4];
+  storage[1].tiled = storage[3].tiled = true;
+  storage[2].compact = storage[3].compact = true;
+  grid grids[4];
+  make_grids(grids, storage, 4, engine);
+
+  //tiling only reorders memory, so values, charge terms and derivatives must
+  //be bitwise identical to the flat layout of the same precision, inside the
+  //box and past its edges where the slope penalty applies
+  std::uniform_real_distribution<fl> coord_dist(-25, 25);
+  std::uniform_real_distribution<fl> charge_dist(-1, 1);
+  for (sz q = 0; q < 1000; ++q) {
+    atom a;
+    a.charge = (q % 4 == 0) ? 0 : charge_dist(engine);
+    vec location(coord_dist(engine), coord_dist(engine), coord_dist(engine));
+    for (sz flat = 0; flat < 4; flat += 2) {
+      const grid& f = grids[flat];
+      const grid& t = grids[flat + 1];
+      BOOST_CHECK_EQUAL(f.evaluate(a, location, 10, 1000),
+          t.evaluate(a, location, 10, 1000));
+      vec fderiv(0, 0, 0), tderiv(0, 0, 0);
+      fl fe = f.evaluate(a, location, 10, 1000, &fderiv);
+      fl te = t.evaluate(a, location, 10, 1000, &tderiv);
+      BOOST_CHECK_EQUAL(fe, te);
+      for (sz i = 0; i < 3; ++i)
+        BOOST_CHECK_EQUAL(fderiv[i], tderiv[i]);
+    }
+  }
+}
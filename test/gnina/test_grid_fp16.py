@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+
+'''Check that docking with --grid_fp16 finds poses scoring within a fixed
+tolerance of docking with float grids'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+# only the monte carlo search reads the grid, final poses are refined and
+# scored without it; half precision grid values (11 significant bits) only
+# perturb the search path, so the best poses should agree closely
+tolerance = 0.5  # kcal/mol
+
+def docked(system, extra):
+    args = '{gnina} -r data/{system}_rec.pdb -l data/{system}_lig.sdf \
+        --autobox_ligand data/{system}_lig.sdf --seed 3 --exhaustiveness 4 \
+        --cpu 1 {extra}'.format(gnina=gnina, system=system, extra=extra)
+    out = subprocess.check_output(args, shell=True).decode()
+    energies = re.findall(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', out, re.M)
+    return float(energies[0])
+
+for system in ['10gs', '184l']:
+    full = docked(system, '')
+    half = docked(system, '--grid_fp16')
+    print(system, 'float grid', full, 'fp16 grid', half)
+    assert abs(half - full) < tolerance
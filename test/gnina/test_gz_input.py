@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+
+'''Check that ligands read from a gzipped file dock exactly as they do from
+the plain file, and that a truncated gzipped file still yields the ligands
+before the damage and nothing after it'''
+
+import sys, os, re, zlib, gzip, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+tmpdir = tempfile.mkdtemp()
+conformers = open('data/10gs_lig_conformers.sdf', 'rb').read()
+
+def write(name, data):
+    fname = os.path.join(tmpdir, name)
+    with open(fname, 'wb') as f:
+        f.write(data)
+    return fname
+
+def run(lig, extra):
+    out = os.path.join(tmpdir, 'out.sdf')
+    subprocess.check_call('{gnina} -r data/10gs_rec.pdb -l {lig} \
+        --autobox_ligand data/10gs_lig.sdf --seed 2 --cpu 1 -o {out} \
+        {extra}'.format(gnina=gnina, lig=lig, out=out, extra=extra),
+        shell=True, stdout=subprocess.DEVNULL)
+    text = open(out, 'rb').read()
+    os.remove(out)
+    return text
+
+# docking the same five ligands from .sdf and .sdf.gz gives the same poses
+dock = '--exhaustiveness 4 --num_modes 3'
+plain = run(write('ligs.sdf', conformers), dock)
+zipped = run(write('ligs.sdf.gz', gzip.compress(conformers)), dock)
+assert plain.count(b'$$$$') == 15
+assert zipped == plain
+
+# cut a larger gzipped file so that the data that still inflates ends in
+# the middle of an atom block, well clear of the edges since the reader
+# may stop a little short of what zlib can recover
+text = conformers * 20
+compressed = gzip.compress(text)
+for cut in range(len(compressed) // 2, len(compressed)):
+    prefix = zlib.decompressobj(31).decompress(compressed[:cut])
+    start = prefix.rfind(b'$$$$\n') + 5
+    counts = prefix.find(b' V2000\n', start)
+    if counts < 0:
+        continue
+    atoms = counts + 7
+    bonds = atoms + 33 * (text.find(b'\n', atoms) - atoms + 1)
+    if atoms + 400 < len(prefix) < bonds - 200:
+        break
+else:
+    assert False, "no cut inside an atom block"
+complete = prefix[:start]
+nligs = complete.count(b'$$$$')
+print('cut at', cut, 'of', len(compressed), 'bytes after', nligs, 'ligands')
+assert 0 < nligs < 100
+
+truncated = write('cut.sdf.gz', compressed[:cut])
+proc = subprocess.run('gzip -t ' + truncated, shell=True,
+                      stderr=subprocess.DEVNULL)
+assert proc.returncode != 0
+
+# the ligands before the damage are minimized, the partial one is not
+# parsed and reading stops there
+minimize = '--minimize'
+damaged = run(truncated, minimize)
+assert damaged.count(b'$$$$') == nligs
+assert damaged == run(write('complete.sdf', complete), minimize)
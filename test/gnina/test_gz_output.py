@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+
+'''Check that .gz output written by several compression threads is valid
+BGZF that decompresses to exactly the uncompressed output'''
+
+import sys, os, struct, zlib, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+tmpdir = tempfile.mkdtemp()
+# enough minimized ligands to fill several 64KB blocks
+lig = os.path.join(tmpdir, 'ligs.sdf')
+with open(lig, 'w') as f:
+    f.write(open('data/10gs_lig_conformers.sdf').read() * 20)
+
+args = '{gnina} -r data/10gs_rec.pdb -l {lig} --minimize --cpu 4'.format(
+    gnina=gnina, lig=lig)
+plain = os.path.join(tmpdir, 'out.sdf')
+gz = os.path.join(tmpdir, 'out.sdf.gz')
+subprocess.check_call(args + ' -o ' + plain, shell=True,
+                      stdout=subprocess.DEVNULL)
+subprocess.check_call(args + ' -o ' + gz, shell=True,
+                      stdout=subprocess.DEVNULL)
+
+expected = open(plain, 'rb').read()
+assert expected.count(b'$$$$') == 100
+decompressed = subprocess.check_output(['gzip', '-dc', gz])
+assert decompressed == expected
+subprocess.check_call(['gzip', '-t', gz])
+
+# every member carries the BGZF extra field with its own size, and the file
+# ends with the empty end of file block
+data = open(gz, 'rb').read()
+pos = 0
+members = 0
+while pos < len(data):
+    magic, method, flags = struct.unpack('<HBB', data[pos:pos + 4])
+    assert magic == 0x8b1f and method == 8 and flags & 4
+    xlen, = struct.unpack('<H', data[pos + 10:pos + 12])
+    si1, si2, slen, bsize = struct.unpack('<BBHH', data[pos + 12:pos + 18])
+    assert (si1, si2, slen) == (66, 67, 2)
+    block = data[pos:pos + bsize + 1]
+    text = zlib.decompress(block[12 + xlen:-8], -15)
+    isize, = struct.unpack('<I', block[-4:])
+    assert isize == len(text) < 65536
+    pos += bsize + 1
+    members += 1
+print(members, 'BGZF blocks')
+assert isize == 0
+assert members > 2
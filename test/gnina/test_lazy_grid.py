@@ -0,0 +1,41 @@
+#!/usr/bin/env python3
+
+'''Check that --lazy_grid docks exactly like the eagerly populated grid,
+with and without a memory limit that forces tiles to be freed, while only
+computing part of the box'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+args = '{gnina} -r data/10gs_rec.pdb -l data/10gs_lig.sdf \
+    --autobox_ligand data/10gs_lig.sdf --autobox_add 12 --seed 7 \
+    --exhaustiveness 2 --cpu 2 -v 2'.format(gnina=gnina)
+
+def dock(extra):
+    out = subprocess.check_output(args + ' ' + extra, shell=True).decode()
+    modes = re.findall(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', out, re.M)
+    tiles = re.search(r'Lazy grid: computed (\d+) of (\d+) tiles, freed (\d+)',
+                      out)
+    return modes, tiles and [int(t) for t in tiles.groups()]
+
+eager, tiles = dock('')
+assert eager
+assert tiles is None  # nothing lazy about the default grid
+
+lazy, (computed, total, freed) = dock('--lazy_grid')
+print('--lazy_grid', lazy, computed, total, freed)
+assert lazy == eager
+# the chains stay near the ligand, most of the padded box is never needed
+assert 0 < computed < total
+assert freed == 0
+
+limited, (lcomputed, ltotal, lfreed) = dock('--lazy_grid --lazy_grid_memory 1')
+print('--lazy_grid_memory 1', limited, lcomputed, ltotal, lfreed)
+assert limited == eager
+assert ltotal == total
+# an 8x8x8 tile of this ligand's types is over 10KB, so 1MB holds less than
+# a hundred; some have to be freed and computed again when chains return
+assert lfreed > 0
+assert lcomputed > computed
@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+
+'''Check that --lbfgs minimizes flexible systems as well as full BFGS,
+that it actually takes a different path to get there and that it is
+rejected with --gpu'''
+
+import sys, re, os
+import subprocess, tempfile
+
+gnina = sys.argv[1]  # path to gnina executable
+
+def coordinates(fname):
+    '''atom lines of the minimized ligand poses'''
+    atoms = []
+    for line in open(fname):
+        fields = line.split()
+        if len(fields) >= 4 and re.match(r'-?\d+\.\d+$', fields[0]):
+            atoms.append(tuple(float(x) for x in fields[:3]))
+    return atoms
+
+tmpdir = tempfile.mkdtemp()
+for system, flexdist in [("10gs", 3.0), ("184l", 3.9)]:
+    args = '{gnina} -r data/{system}_rec.pdb -l data/{system}_lig.sdf --minimize \
+        --flexdist {flexdist} --flexdist_ligand data/{system}_lig.sdf \
+        --cpu 1'.format(gnina=gnina, system=system, flexdist=flexdist)
+
+    energies = []
+    poses = []
+    for i, extra in enumerate(['', '--lbfgs', '--lbfgs --lbfgs_history 3']):
+        outname = os.path.join(tmpdir, '%s_%d.sdf' % (system, i))
+        out = subprocess.check_output(args + ' ' + extra + ' -o ' + outname,
+                shell=True).decode()
+        energies.append(float(re.search(r'Affinity:\s+(\S+)', out).group(1)))
+        poses.append(coordinates(outname))
+    print(system, energies)
+
+    for e in energies[1:]:
+        assert e < energies[0] + 0.5
+
+    # the minimizers must reach their minima along different paths; if
+    # --lbfgs or --lbfgs_history were ignored the poses would be identical
+    assert len(poses[0]) > 0
+    assert all(len(p) == len(poses[0]) for p in poses)
+    assert poses[1] != poses[0], "--lbfgs did not change the minimizer"
+    assert poses[2] != poses[1], "--lbfgs_history did not change the minimizer"
+
+# there is no GPU L-BFGS, so asking for both is a usage error
+proc = subprocess.run('{gnina} -r data/184l_rec.pdb -l data/184l_lig.sdf \
+        --minimize --lbfgs --gpu'.format(gnina=gnina), shell=True,
+        stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+assert proc.returncode != 0
+assert b'--lbfgs is not supported with --gpu' in proc.stderr
@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+
+'''Check that gninatyper's .molcache2 output holds, under the paths a types
+file would use, exactly the atoms of the separate .gninatypes files'''
+
+import sys, os, struct, shutil, tempfile, gzip
+import subprocess
+
+gninatyper = os.path.abspath(sys.argv[1])  # path to gninatyper executable
+
+def read_molcache(fname):
+    buf = open(fname, 'rb').read()
+    version, start = struct.unpack_from('=iQ', buf, 0)
+    assert version == -1
+    mols = {}
+    pos = start
+    while pos < len(buf):
+        n = buf[pos]
+        name = buf[pos+1:pos+1+n].decode()
+        offset, = struct.unpack_from('Q', buf, pos+1+n)
+        pos += 1+n+8
+        natoms, = struct.unpack_from('i', buf, offset)
+        mols[name] = buf[offset+4:offset+4+16*natoms]
+    return mols
+
+tmp = tempfile.mkdtemp()
+try:
+    # one titled and one untitled molecule per directory, one input gzipped
+    for d, files in [('a', ['184l_lig.sdf', 'C8bent.sdf']), ('b/c', ['10gs_lig.sdf'])]:
+        os.makedirs(os.path.join(tmp, d))
+        multi = os.path.join(tmp, d, 'mols.sdf')
+        with open(multi, 'wb') as out:
+            for f in files:
+                out.write(open(os.path.join('data', f), 'rb').read())
+        shutil.copy(os.path.join('data', files[0]), os.path.join(tmp, d))
+        # separate files, written next to their inputs
+        for f in os.listdir(os.path.join(tmp, d)):
+            subprocess.check_call([gninatyper, f], cwd=os.path.join(tmp, d))
+    gz = os.path.join(tmp, 'a', 'mols.sdf.gz')
+    with gzip.open(gz, 'wb') as out:
+        out.write(open(os.path.join(tmp, 'a', 'mols.sdf'), 'rb').read())
+    os.rename(os.path.join(tmp, 'a', 'mols.sdf'), os.path.join(tmp, 'a', 'mols.sdf.orig'))
+
+    expected = {}
+    for root, dirs, files in os.walk(tmp):
+        for f in files:
+            if f.endswith('.gninatypes'):
+                path = os.path.join(root, f)
+                expected[os.path.relpath(path, tmp)] = open(path, 'rb').read()
+
+    inputs = [gz, os.path.join(tmp, 'a', '184l_lig.sdf'),
+              os.path.join(tmp, 'b', 'c', 'mols.sdf'), os.path.join(tmp, 'b', 'c', '10gs_lig.sdf')]
+    cache = os.path.join(tmp, 'all.molcache2')
+    subprocess.check_call([gninatyper, '--cpu', '3', '--data_root', tmp] + inputs + [cache])
+    mols = read_molcache(cache)
+    print(sorted(mols))
+    # a title repeated across inputs in one directory gets the next index
+    assert 'a/184L_I4B_A_401_1.gninatypes' in mols
+    assert 'a/mols_0.gninatypes' in mols and 'b/c/10GS_VWW_A_210_0.gninatypes' in mols
+    for name, data in expected.items():
+        if name in mols:
+            assert mols[name] == data, name
+    assert set(expected) <= set(mols)
+    # a single worker types the same molecules
+    single = os.path.join(tmp, 'single.molcache2')
+    subprocess.check_call([gninatyper, '--cpu', '1', '--data_root', tmp] + inputs + [single])
+    assert read_molcache(single) == mols
+
+    # options are only for .molcache2 output
+    assert subprocess.call([gninatyper, '--cpu', '2', inputs[1], os.path.join(tmp, 'x.gninatypes')]) != 0
+finally:
+    shutil.rmtree(tmp)
@@ -0,0 +1,40 @@
+#!/usr/bin/env python3
+
+'''Check that refining and rescoring poses, and computing their atom terms,
+is spread over the --cpu threads and gives the same results as doing it on
+one'''
+
+import sys, os, re, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+args = '{gnina} -r data/184l_rec.pdb -l data/184l_lig.sdf \
+    --autobox_ligand data/184l_lig.sdf --seed 3 --exhaustiveness 4 \
+    --num_modes 9 -v 2'.format(gnina=gnina)
+
+def dock(cpu):
+    fd, termsname = tempfile.mkstemp(suffix='.txt')
+    os.close(fd)
+    out = subprocess.check_output(args + ' --cpu %d --atom_terms %s' %
+                                  (cpu, termsname), shell=True).decode()
+    terms = open(termsname).read()
+    os.remove(termsname)
+    modes = re.findall(r'^\s+\d+\s+\S+\s+\S+\s+\S+\s*$', out, re.M)
+    poses, threads = re.search(r'Refining (\d+) poses on (\d+) threads',
+                               out).groups()
+    return modes, terms, int(poses), int(threads)
+
+serial, serialterms, poses, threads = dock(1)
+assert serial and serialterms
+assert threads == 1
+# the search keeps more poses than there are threads to refine them on
+assert poses > 4
+
+for cpu in [2, 4]:
+    parallel, terms, ppose, threads = dock(cpu)
+    print(cpu, threads, parallel)
+    assert threads == cpu
+    assert ppose == poses
+    assert parallel == serial
+    assert terms == serialterms
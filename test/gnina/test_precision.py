@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+
+'''Report the drift of quantized (int8) CNN scores from full precision scores'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+complexes = ['10gs', '184l']
+maxscorediff = 0.05
+maxaffdiff = 0.25
+
+def cnnscores(rec, lig, precision):
+    out = subprocess.check_output('%s -r %s -l %s --score_only --cnn_scoring --cnn_precision %s --cpu 1' %
+            (gnina, rec, lig, precision), shell=True).decode()
+    score = float(re.search(r'CNNscore: (\S+)', out).group(1))
+    aff = float(re.search(r'CNNaffinity: (\S+)', out).group(1))
+    return score, aff
+
+scorediffs = []
+affdiffs = []
+for name in complexes:
+    rec = 'data/%s_rec.pdb' % name
+    lig = 'data/%s_lig.sdf' % name
+    score, aff = cnnscores(rec, lig, 'fp32')
+    qscore, qaff = cnnscores(rec, lig, 'int8')
+    scorediffs.append(abs(score - qscore))
+    affdiffs.append(abs(aff - qaff))
+    print('%s CNNscore %.5f int8 %.5f  CNNaffinity %.5f int8 %.5f' % (name, score, qscore, aff, qaff))
+
+print('Mean CNNscore drift %.5f (max %.5f)' % (sum(scorediffs)/len(scorediffs), max(scorediffs)))
+print('Mean CNNaffinity drift %.5f (max %.5f)' % (sum(affdiffs)/len(affdiffs), max(affdiffs)))
+assert max(scorediffs) < maxscorediff
+assert max(affdiffs) < maxaffdiff
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+
+'''Check that --prefilter passes a crystal ligand in its own pocket and
+catches it in a box too small to hold it'''
+
+import sys, os, re, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+#center of the ligand from its V2000 atom block
+lines = open('data/10gs_lig.sdf').read().split('\n')
+natoms = int(lines[3][:3])
+xyz = [[float(l[0:10]), float(l[10:20]), float(l[20:30])]
+       for l in lines[4:4 + natoms]]
+center = [sum(c[i] for c in xyz) / natoms for i in range(3)]
+
+base = '{gnina} -r data/10gs_rec.pdb -l data/10gs_lig.sdf --seed 2 \
+    --exhaustiveness 2 --cpu 2 --prefilter'.format(gnina=gnina)
+tiny = ' --center_x %f --center_y %f --center_z %f --size_x 1 --size_y 1 \
+    --size_z 1' % tuple(center)
+
+def run(extra, cmd=base):
+    fd, outname = tempfile.mkstemp(suffix='.sdf')
+    os.close(fd)
+    log = subprocess.check_output(cmd + extra + ' -o ' + outname,
+                                  shell=True).decode()
+    out = open(outname).read()
+    os.remove(outname)
+    return log, out
+
+log, out = run(' --autobox_ligand data/10gs_lig.sdf')
+assert 'Prefilter caught 0 of 1' in log
+assert '<minimizedAffinity>' in out and '<prefilter>' not in out
+
+log, out = run(tiny)
+assert 'Prefilter caught 1 of 1' in log
+assert '<prefilter>' in out and '<minimizedAffinity>' not in out
+assert out.count('$$$$') == 1
+# a 1A box plus its margin has far less room than the ligand needs
+reason = out.split('<prefilter>')[1].split('\n')[1]
+assert re.match(r'ligand volume \S+ A\^3 exceeds the \S+ A\^3 of free space',
+                reason), reason
+
+# without the option the same ligand is docked as usual
+log, out = run(tiny, base.replace(' --prefilter', ''))
+assert 'Prefilter caught' not in log
+assert '<minimizedAffinity>' in out and '<prefilter>' not in out
+
+log, out = run(tiny + ' --prefilter_exhaustiveness 1')
+assert '<prefilter>' in out and '<minimizedAffinity>' in out
@@ -0,0 +1,31 @@
+#!/usr/bin/env python3
+
+'''Check that receptors loaded from --receptor_cache score and minimize
+exactly like freshly prepared receptors, with and without flexible residues,
+and report the same flexible residues'''
+
+import sys, os, re, shutil, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+def run(args):
+    out = subprocess.check_output('%s %s --cpu 1' % (gnina, args), shell=True).decode()
+    return re.findall(r'Affinity: (.*)', out), re.findall(r'Flexible residues:.*', out)
+
+cachedir = tempfile.mkdtemp()
+try:
+    for flex in ['', '--flexdist 3.5 --flexdist_ligand data/184l_lig.sdf']:
+        for mode in ['--score_only', '--minimize']:
+            args = '-r data/184l_rec.pdb -l data/184l_lig.sdf %s %s' % (mode, flex)
+            ref, refres = run(args)
+            first, firstres = run(args + ' --receptor_cache ' + cachedir)  # fills cache
+            second, secondres = run(args + ' --receptor_cache ' + cachedir)  # reads cache
+            print(mode, flex, ref, first, second, refres, secondres)
+            assert ref and ref == first == second
+            assert refres == firstres == secondres
+            assert bool(refres) == bool(flex)
+    # one prepared receptor per flex setting
+    assert len(os.listdir(cachedir)) == 2
+finally:
+    shutil.rmtree(cachedir)
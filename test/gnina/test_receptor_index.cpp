@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <random>
+#include "receptor_index.h"
+#include "test_receptor_index.h"
+#include "test_utils.h"
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+static void make_receptor(atomv& atoms, std::mt19937& engine) {
+  std::vector<atom_params> mol_atoms;
+  std::vector<smt> mol_types;
+  make_mol(mol_atoms, mol_types, engine, 0, 200, 1000, 15, 15, 15);
+  atoms.resize(mol_atoms.size());
+  for (size_t i = 0; i < mol_atoms.size(); ++i) {
+    atoms[i].sm = mol_types[i];
+    atoms[i].coords = *(vec*) &mol_atoms[i];
+  }
+}
+
+void test_receptor_index_candidates() {
+  p_args.log << "Receptor Index Candidates Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  std::mt19937 engine(p_args.seed);
+  atomv atoms;
+  make_receptor(atoms, engine);
+  fl cutoff = 8;
+  receptor_index index(atoms, cutoff);
+
+  //every indexed atom within the cutoff of a point must be a candidate, and
+  //candidates must be ascending
+  std::uniform_real_distribution<float> coord_dist(-25, 25);
+  szv candidates;
+  for (size_t q = 0; q < 100; ++q) {
+    vec p(coord_dist(engine), coord_dist(engine), coord_dist(engine));
+    index.candidates(p, candidates);
+    BOOST_CHECK(std::is_sorted(candidates.begin(), candidates.end()));
+    for (size_t i = 0; i < atoms.size(); ++i) {
+      smt t = atoms[i].get();
+      if (t >= num_atom_types() || is_hydrogen(t)) continue;
+      if (vec_distance_sqr(atoms[i].coords, p) < sqr(cutoff)) {
+        BOOST_CHECK(std::binary_search(candidates.begin(), candidates.end(),
+            i));
+      }
+    }
+  }
+}
+
+void test_receptor_index_matches() {
+  p_args.log << "Receptor Index Matches Test \n";
+  p_args.log << "Using random seed: " << p_args.seed << "\n";
+  p_args.log << "Iteration " << p_args.iter_count;
+  p_args.log.endl();
+  std::mt19937 engine(p_args.seed);
+  atomv atoms;
+  make_receptor(atoms, engine);
+  receptor_index index(atoms, 8);
+
+  BOOST_CHECK(index.matches(atoms, 8));
+  BOOST_CHECK(!index.matches(atoms, 6));
+  BOOST_CHECK(index.check_coords(atoms));
+
+  //same size and cutoff but different atoms
+  atomv other(atoms);
+  other[0].coords[0] += 1;
+  BOOST_CHECK(!index.matches(other, 8));
+  BOOST_CHECK(!index.check_coords(other));
+
+  //same atoms moved in place
+  atoms[0].coords[0] += 1;
+  BOOST_CHECK(!index.check_coords(atoms));
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+void test_receptor_index_candidates();
+void test_receptor_index_matches();
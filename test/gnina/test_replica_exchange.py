@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+
+'''Check that docking with replica exchange ladders tries the expected
+neighbor swaps, accepts some of them, still finds the crystal pose, and
+rejects bad ladder settings'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+args = '{gnina} -r data/10gs_rec.pdb -l data/10gs_lig.sdf \
+    --autobox_ligand data/10gs_lig.sdf --seed 7 --exhaustiveness 8 \
+    --cpu 2 -v 2'.format(gnina=gnina)
+
+def dock(extra):
+    out = subprocess.check_output(args + ' ' + extra, shell=True).decode()
+    energies = re.findall(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', out, re.M)
+    assert energies
+    swaps = re.search(r'Replica exchange: (\d+) of (\d+) swaps accepted', out)
+    return float(energies[0]), swaps and [int(s) for s in swaps.groups()]
+
+plain, swaps = dock('')
+assert swaps is None
+
+# 8 chains make 2 ladders of 4 replicas; 100 steps exchanging every 5 is 20
+# rounds, alternating between 2 even and 1 odd neighbor pair per ladder
+replica, (accepted, tried) = dock('--replicas 4 --exchange_interval 5 \
+    --num_mc_steps 100')
+print('independent chains', plain, 'replica exchange', replica,
+      'swaps', accepted, 'of', tried)
+assert tried == 2 * (10 * 2 + 10 * 1)
+# neighbors overlap in energy, so some but not all swaps go through
+assert 0 < accepted < tried
+
+# with the default number of steps it should still dock as well as
+# independent chains
+replica, (accepted, tried) = dock('--replicas 4 --exchange_interval 5')
+print('default steps', replica, 'swaps', accepted, 'of', tried)
+assert accepted > 0
+assert replica < plain + 1.0
+
+for bad in ['--replicas 0', '--replicas 4 --replica_max_temp 1',
+            '--replicas 4 --exchange_interval 0']:
+    ret = subprocess.call(args + ' ' + bad, shell=True,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    assert ret != 0, bad
@@ -0,0 +1,28 @@
+#!/usr/bin/env python3
+
+'''Check that --rescore reports the same energies and terms as --score_only'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+for name in ['10gs', '184l']:
+    args = '%s -r data/%s_rec.pdb -l data/%s_lig.sdf' % (gnina, name, name)
+
+    out = subprocess.check_output(args + ' --score_only --cpu 1', shell=True).decode()
+    aff = float(re.search(r'Affinity: (\S+)', out).group(1))
+    intra = float(re.search(r'Intramolecular energy: (\S+)', out).group(1))
+    terms = [float(x) for x in re.search(r'^## (?!Name )\S+ (.*)$', out, re.M).group(1).split()]
+
+    for cpu in [1, 4]:
+        out = subprocess.check_output(args + ' --rescore --rescore_terms --cpu %d' % cpu,
+                shell=True).decode()
+        lines = [l for l in out.split('\n') if l.strip() and not l.startswith('#')]
+        vals = [float(x) for x in lines[-1].split()[1:]]
+        print(name, cpu, aff, intra, vals[:2])
+        assert abs(vals[0] - aff) < 1e-4
+        assert abs(vals[1] - intra) < 1e-4
+        assert len(vals[2:]) == len(terms)
+        for a, b in zip(vals[2:], terms):
+            assert abs(a - b) < 1e-4
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+
+'''Check that --rigid_conformers docks consecutive conformers of a molecule
+as one ligand, that every pose is one of the input conformers moved as a
+rigid body, that grouping stops at the next molecule, that the crystal
+conformer docks back into place, and that rigid conformers score as the
+flexible ligands do'''
+
+import sys, os, re, math, tempfile
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+# five conformers of the 10gs ligand: the crystal pose and four made by
+# rotating it about single bonds
+conformers = 'data/10gs_lig_conformers.sdf'
+
+def heavy_distances(record):
+    '''sorted heavy atom pair distances of a V2000 record, which only depend
+    on the conformer, not on its pose or atom order'''
+    lines = record.strip('\n').split('\n')
+    natoms = int(lines[3][:3])
+    xyz = [[float(l[0:10]), float(l[10:20]), float(l[20:30])]
+           for l in lines[4:4 + natoms] if l.split()[3] != 'H']
+    return sorted(math.dist(a, b) for i, a in enumerate(xyz)
+                  for b in xyz[:i])
+
+def records(text):
+    return [r for r in text.split('$$$$') if r.strip()]
+
+shapes = [heavy_distances(r) for r in records(open(conformers).read())]
+assert len(shapes) == 5
+
+def conformer_of(record):
+    d = heavy_distances(record)
+    for i, s in enumerate(shapes):
+        if len(s) == len(d) and max(abs(x - y) for x, y in zip(s, d)) < 0.01:
+            return i
+    return None
+
+def run(lig, extra):
+    fd, outname = tempfile.mkstemp(suffix='.sdf')
+    os.close(fd)
+    log = subprocess.check_output('{gnina} -r data/10gs_rec.pdb -l {lig} \
+        --autobox_ligand data/10gs_lig.sdf --seed 2 --exhaustiveness 8 \
+        --cpu 2 -o {out}{extra}'.format(gnina=gnina, lig=lig,
+                                        out=outname, extra=extra),
+        shell=True).decode()
+    out = open(outname).read()
+    os.remove(outname)
+    return log, out
+
+modes = re.compile(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', re.M)
+
+#without the option the conformers are separate, flexible ligands
+log, out = run(conformers, '')
+assert log.count('mode |   affinity') == 5
+
+log, out = run(conformers, ' --rigid_conformers')
+assert log.count('mode |   affinity') == 1
+energies = [float(e) for e in modes.findall(log)]
+assert energies and energies == sorted(energies)
+poses = records(out)
+assert len(poses) == len(energies)
+#no torsions are searched, so every pose has the exact internal geometry of
+#one of the inputs
+placed = [conformer_of(p) for p in poses]
+print('conformers of the poses', placed)
+assert None not in placed
+assert energies[0] < -4
+
+#a different molecule after the conformers starts a new ligand
+fd, mixed = tempfile.mkstemp(suffix='.sdf')
+os.close(fd)
+with open(mixed, 'w') as f:
+    f.write(open(conformers).read() + open('data/184l_lig.sdf').read())
+log, out = run(mixed, ' --rigid_conformers')
+os.remove(mixed)
+assert log.count('mode |   affinity') == 2
+
+#only the search is rigid: each conformer scores as it does when read as a
+#flexible ligand, with the same torsion count in the affinity
+def score(extra):
+    return subprocess.check_output('{gnina} -r data/10gs_rec.pdb -l {lig} \
+        --score_only --cpu 1{extra}'.format(gnina=gnina, lig=conformers,
+                                            extra=extra), shell=True).decode()
+
+affinity = re.compile(r'^Affinity:\s+(\S+)', re.M)
+flexible = [float(a) for a in affinity.findall(score(''))]
+rigid = [float(a) for a in affinity.findall(score(' --rigid_conformers'))]
+print('flexible', flexible, 'rigid', rigid)
+assert len(flexible) == 5 and len(rigid) == 5
+for f, r in zip(flexible, rigid):
+    assert abs(f - r) < 1e-4, (f, r)
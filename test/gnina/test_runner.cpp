@@ -6,6 +6,10 @@
 #include "test_tree.h"
 #include "test_cache.h"
 #include "test_cnn.h"
+#include "test_flat_tree.h"
+#include "test_fp16.h"
+#include "test_grid.h"
+#include "test_receptor_index.h"
 #include "test_utils.h"
 #define N_ITERS 5
 #define BOOST_TEST_DYN_LINK
@@ -48,6 +52,18 @@ BOOST_AUTO_TEST_CASE(derivative) {
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(test_flat_tree)
+
+BOOST_AUTO_TEST_CASE(set_conf) {
+  boost_loop_test(&test_flat_tree_set_conf);
+}
+
+BOOST_AUTO_TEST_CASE(derivative) {
+  boost_loop_test(&test_flat_tree_derivative);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(cache_gpu)
 
 BOOST_AUTO_TEST_CASE(eval_deriv) {
@@ -56,6 +72,42 @@ BOOST_AUTO_TEST_CASE(eval_deriv) {
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(test_fp16)
+
+BOOST_AUTO_TEST_CASE(roundtrip) {
+  boost_loop_test(&test_fp16_roundtrip);
+}
+
+BOOST_AUTO_TEST_CASE(saturation) {
+  boost_loop_test(&test_fp16_saturation);
+}
+
+BOOST_AUTO_TEST_CASE(subnormal) {
+  boost_loop_test(&test_fp16_subnormal);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(test_grid)
+
+BOOST_AUTO_TEST_CASE(tiled) {
+  boost_loop_test(&test_grid_tiled);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(test_receptor_index)
+
+BOOST_AUTO_TEST_CASE(candidates) {
+  boost_loop_test(&test_receptor_index_candidates);
+}
+
+BOOST_AUTO_TEST_CASE(matches) {
+  boost_loop_test(&test_receptor_index_matches);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 BOOST_AUTO_TEST_SUITE(test_cnn)
 
 BOOST_AUTO_TEST_CASE(set_atom_gradients) {
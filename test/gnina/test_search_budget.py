@@ -0,0 +1,36 @@
+#!/usr/bin/env python3
+
+'''Check that --ligands_per_hour shrinks the search of later ligands when the
+target rate is much faster than the default search'''
+
+import sys, re, time
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+args = '{gnina} -r data/184l_rec.pdb -l data/184l_lig.sdf -l data/184l_lig.sdf \
+    -l data/184l_lig.sdf --autobox_ligand data/184l_lig.sdf --seed 5 \
+    --exhaustiveness 8 --cpu 2 -v 2'.format(gnina=gnina)
+
+start = time.time()
+out = subprocess.check_output(args + ' --ligands_per_hour 100000',
+                              shell=True).decode()
+elapsed = time.time() - start
+budgets = re.findall(r'Search budget: (\d+) chains of (\d+) steps', out)
+print(budgets)
+assert len(budgets) == 3
+work = [int(c) * int(s) for c, s in budgets]
+assert budgets[0][0] == '8'  # the first ligand calibrates with the defaults
+assert work[2] < work[0]
+# ligands are charged their wall time on the 2 docking threads, which can
+# not add up to more than the whole run on 2 threads
+used = float(re.search(r'Search budget used (\S+) CPU hours', out).group(1))
+assert 0 < used * 3600 <= elapsed * 2
+assert re.search(r'^\s+1\s+\S+\s+\S+\s+\S+\s*$', out, re.M)
+
+for bad in ['--ligands_per_hour -1', '--cpu_budget 1',
+            '--ligands_per_hour 10 --score_only',
+            '--ligands_per_hour 10 --replicas 4']:
+    ret = subprocess.call(args + ' ' + bad, shell=True,
+                          stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    assert ret != 0, bad
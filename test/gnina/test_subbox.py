@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+
+'''Check that --subbox_size splits a box into the expected sub-boxes, each
+with a grid no larger than the whole box, and that splitting finds as good
+a pose as a search of the whole box with the same number of chains'''
+
+import sys, re
+import subprocess
+
+gnina = sys.argv[1]  # path to gnina executable
+
+#center of the ligand from its V2000 atom block
+lines = open('data/10gs_lig.sdf').read().split('\n')
+natoms = int(lines[3][:3])
+xyz = [[float(l[0:10]), float(l[10:20]), float(l[20:30])]
+       for l in lines[4:4 + natoms]]
+center = [sum(c[i] for c in xyz) / natoms for i in range(3)]
+
+# 28A is 75 intervals of 0.375A, a span of 28.125A per side
+args = '{gnina} -r data/10gs_rec.pdb -l data/10gs_lig.sdf \
+    --center_x {0} --center_y {1} --center_z {2} \
+    --size_x 28 --size_y 28 --size_z 28 \
+    --seed 11 --cpu 2 -v 2'.format(*center, gnina=gnina)
+tolerance = 1.0  # kcal/mol between the best poses
+
+def dock(extra):
+    out = subprocess.check_output(args + ' ' + extra, shell=True).decode()
+    energies = re.findall(r'^\s+\d+\s+(\S+)\s+\S+\s+\S+\s*$', out, re.M)
+    whole = re.search(r'Search grid: (\d+) x (\d+) x (\d+) points', out)
+    split = re.search(r'Searching (\d+) sub-boxes of up to (\d+) x (\d+) x '
+                      r'(\d+) points', out)
+    return (float(energies[0]), whole and [int(n) for n in whole.groups()],
+            split and [int(n) for n in split.groups()])
+
+# every region gets --exhaustiveness chains, so give the whole box as many
+wholee, whole, split = dock('--exhaustiveness 16')
+assert whole == [76, 76, 76] and split is None
+
+for size, pieces in [(15, 2), (10, 3)]:
+    e, grid, split = dock('--exhaustiveness 2 --subbox_size %d' % size)
+    print('sub-box size', size, split, e, 'whole box', wholee)
+    assert grid is None
+    assert split[0] == pieces ** 3
+    assert all(n <= 76 for n in split[1:])
+    if size == 15:
+        assert e < wholee + tolerance
+
+# a box that already fits is searched whole
+e, grid, split = dock('--exhaustiveness 2 --subbox_size 30')
+assert grid == [76, 76, 76] and split is None
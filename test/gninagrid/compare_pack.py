@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+
+'''Compare two gridpack files (possibly with different compression) and check
+their labels against the types file they were generated from'''
+
+import sys,struct,zlib
+import pytest
+
+from pytest import approx
+
+HEADER = '8sIIIIIfQQ'
+
+def read_pack(fname):
+    buf = open(fname,'rb').read()
+    (magic,version,flags,channels,dim,nlabels,res,count,indexoff) = struct.unpack_from(HEADER,buf,0)
+    assert magic == b'GNINAPAK'
+    n = channels*dim*dim*dim
+    examples = []
+    pos = indexoff
+    for i in range(count):
+        offset,size = struct.unpack_from('QQ',buf,pos)
+        pos += 16
+        labels = struct.unpack_from('f'*nlabels,buf,pos)
+        pos += 4*nlabels
+        data = buf[offset:offset+size]
+        if flags & 1:
+            data = zlib.decompress(data, 16+zlib.MAX_WBITS)
+        assert len(data) == 4*n
+        examples.append((labels,struct.unpack('f'*n,data)))
+    return examples
+
+ex1 = read_pack(sys.argv[1])
+ex2 = read_pack(sys.argv[2])
+assert len(ex1) == len(ex2)
+
+labels = [float(line.split()[0]) for line in open(sys.argv[3]) if line.strip()]
+assert len(labels) == len(ex1)
+
+for (l1,v1),(l2,v2),l in zip(ex1,ex2,labels):
+    assert l1[0] == l
+    assert l2[0] == l
+    assert v1 == approx(v2,abs=1e-4)
+    assert max(v1) > 0